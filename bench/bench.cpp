@@ -0,0 +1,292 @@
+// bench.cpp — slate-bench: microbenchmarks for editor hot paths
+//
+//   slate-bench [--max-bytes 64M] [--filter substr] [--out file.json]
+//               [--compare baseline.json] [--threshold 10]
+//
+// Results go to stdout (or --out) as JSON, one benchmark per line, so a run
+// can be saved and used as the --compare baseline of a later run. With
+// --compare, any benchmark slower than the baseline by more than
+// --threshold percent is reported and the exit status is 1.
+#include "app.h"
+#include "buffer.h"
+#include "scripting.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using Clock  = std::chrono::steady_clock;
+
+// Reaches into VedApp for the private render/search/scripting paths.
+struct BenchAccess {
+    static Buffer& focused(VedApp& app) { return *app.sm_.focused_leaf()->buffer; }
+    static ftxui::Element render_line(VedApp& app, const Buffer& b, int row,
+                                      const std::string& ext) {
+        return app.render_line(b, row, ext);
+    }
+    static void do_search(VedApp& app, const std::string& q) { app.do_search(q); }
+    static ScriptingEngine& scripting(VedApp& app) { return *app.scripting_; }
+};
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Harness
+// ════════════════════════════════════════════════════════════════════════════
+
+struct Result {
+    std::string name;
+    size_t      bytes = 0;
+    int         iterations = 0;
+    double      ns_per_op = 0;
+};
+
+static std::vector<Result> g_results;
+static std::string         g_filter;
+
+// Runs fn until ~0.3 s have passed (at least 3 runs, or 1 for huge inputs)
+// and keeps the median, which is robust to the odd page-fault spike.
+static void bench(const std::string& name, size_t bytes,
+                  const std::function<void()>& fn, int ops_per_call = 1) {
+    if (!g_filter.empty() && name.find(g_filter) == std::string::npos) return;
+    std::vector<double> samples;
+    auto begin = Clock::now();
+    int min_runs = bytes >= (256u << 20) ? 1 : 3;
+    do {
+        auto t0 = Clock::now();
+        fn();
+        samples.push_back(
+            std::chrono::duration<double, std::nano>(Clock::now() - t0).count() /
+            ops_per_call);
+    } while ((int)samples.size() < min_runs ||
+             (Clock::now() - begin < std::chrono::milliseconds(300) &&
+              samples.size() < 100000));
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                     samples.end());
+    Result r{name, bytes, (int)samples.size(), samples[samples.size() / 2]};
+    std::fprintf(stderr, "%-40s %12.1f ns/op  (%d runs)\n", name.c_str(),
+                 r.ns_per_op, r.iterations);
+    g_results.push_back(r);
+}
+
+static std::string size_label(size_t n) {
+    if (n >= (1u << 30)) return std::to_string(n >> 30) + "G";
+    if (n >= (1u << 20)) return std::to_string(n >> 20) + "M";
+    return std::to_string(n >> 10) + "K";
+}
+
+static size_t parse_size(const std::string& s) {
+    size_t n = std::strtoull(s.c_str(), nullptr, 10);
+    switch (s.empty() ? 0 : s.back()) {
+    case 'K': case 'k': return n << 10;
+    case 'M': case 'm': return n << 20;
+    case 'G': case 'g': return n << 30;
+    }
+    return n;
+}
+
+// C++-looking lines so the default highlight rules have work to do.
+static std::vector<std::string> gen_lines(size_t bytes) {
+    std::vector<std::string> lines;
+    size_t total = 0;
+    char buf[128];
+    for (int i = 0; total < bytes; ++i) {
+        int n = std::snprintf(buf, sizeof(buf),
+            "    int value_%d = compute(%d, \"label %d\", 0x%x); // step %d",
+            i, i * 7, i % 97, i, i % 13);
+        lines.emplace_back(buf, n);
+        total += n + 1;
+    }
+    return lines;
+}
+
+static void write_lines(const fs::path& p, const std::vector<std::string>& lines) {
+    std::ofstream f(p);
+    for (auto& l : lines) f << l << '\n';
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Benchmarks
+// ════════════════════════════════════════════════════════════════════════════
+
+static void bench_buffer(const fs::path& dir, size_t bytes) {
+    auto lines = gen_lines(bytes);
+    auto path  = dir / ("input-" + size_label(bytes) + ".cpp");
+    write_lines(path, lines);
+    std::string sz = "/" + size_label(bytes);
+
+    bench("buffer.load" + sz, bytes, [&] {
+        Buffer b;
+        b.load(path.string());
+    });
+
+    Buffer b;
+    b.load(path.string());
+    b.filepath = (dir / ("out-" + size_label(bytes) + ".cpp")).string();
+    bench("buffer.save" + sz, bytes, [&] { b.save(); });
+
+    bench("buffer.push_undo+undo" + sz, bytes, [&] {
+        b.push_undo();
+        b.undo();
+    });
+}
+
+static void bench_search(VedApp& app, size_t bytes) {
+    auto& buf = BenchAccess::focused(app);
+    buf.lines = gen_lines(bytes);
+    std::string sz = "/" + size_label(bytes);
+    bench("search.literal" + sz, bytes,
+          [&] { BenchAccess::do_search(app, "compute"); });
+    bench("search.regex" + sz, bytes,
+          [&] { BenchAccess::do_search(app, R"(value_\d+7\b)"); });
+    BenchAccess::do_search(app, "");
+}
+
+static void bench_render(VedApp& app) {
+    auto& buf = BenchAccess::focused(app);
+    buf.lines = gen_lines(64 << 10);
+    buf.cursor_row = 0;
+    const int screen = 50;
+    bench("render_line.cpp_rules", 0, [&] {
+        for (int r = 0; r < screen; ++r)
+            BenchAccess::render_line(app, buf, r, ".cpp");
+    }, screen);
+    bench("render_line.no_rules", 0, [&] {
+        for (int r = 0; r < screen; ++r)
+            BenchAccess::render_line(app, buf, r, ".txt");
+    }, screen);
+}
+
+static void bench_wren(VedApp& app) {
+    auto& engine = BenchAccess::scripting(app);
+    WrenVM* vm = engine.vm();
+    wrenInterpret(vm, "bench",
+        "var nop = Fn.new { }\n"
+        "var echo = Fn.new { |s| s }\n"
+        "var two = Fn.new { |a, b| a }\n");
+    auto handle = [&](const char* var) {
+        wrenEnsureSlots(vm, 1);
+        wrenGetVariable(vm, "bench", var, 0);
+        return wrenGetSlotHandle(vm, 0);
+    };
+    WrenCallback nop {handle("nop"),  wrenMakeCallHandle(vm, "call()")};
+    WrenCallback echo{handle("echo"), wrenMakeCallHandle(vm, "call(_)")};
+    WrenCallback two {handle("two"),  wrenMakeCallHandle(vm, "call(_,_)")};
+    std::string arg(64, 'x');
+    const int n = 1000;
+
+    bench("wren.call0", 0, [&] { for (int i = 0; i < n; ++i) engine.call0(nop); }, n);
+    bench("wren.call", 0, [&] { for (int i = 0; i < n; ++i) engine.call(echo, arg); }, n);
+    bench("wren.call2", 0, [&] { for (int i = 0; i < n; ++i) engine.call2(two, arg, arg); }, n);
+    bench("wren.call_str", 0, [&] { for (int i = 0; i < n; ++i) engine.call_str(nop); }, n);
+
+    for (auto* cb : {&nop, &echo, &two}) {
+        wrenReleaseHandle(vm, cb->receiver);
+        wrenReleaseHandle(vm, cb->method);
+    }
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Output / compare
+// ════════════════════════════════════════════════════════════════════════════
+
+static void write_json(std::ostream& os) {
+    os << "{\"benchmarks\": [\n";
+    for (size_t i = 0; i < g_results.size(); ++i) {
+        auto& r = g_results[i];
+        char line[256];
+        std::snprintf(line, sizeof(line),
+            "{\"name\": \"%s\", \"bytes\": %zu, \"iterations\": %d, \"ns_per_op\": %.1f}",
+            r.name.c_str(), r.bytes, r.iterations, r.ns_per_op);
+        os << "  " << line << (i + 1 < g_results.size() ? "," : "") << "\n";
+    }
+    os << "]}\n";
+}
+
+// Reads files written by write_json (one benchmark object per line).
+static std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> out;
+    std::ifstream f(path);
+    std::regex re(R"re("name": "([^"]+)".*"ns_per_op": ([0-9.eE+-]+))re");
+    std::string line;
+    std::smatch m;
+    while (std::getline(f, line))
+        if (std::regex_search(line, m, re)) out[m[1]] = std::stod(m[2]);
+    return out;
+}
+
+static int compare(const std::string& path, double threshold_pct) {
+    auto base = read_baseline(path);
+    if (base.empty()) {
+        std::fprintf(stderr, "no benchmarks in baseline %s\n", path.c_str());
+        return 2;
+    }
+    int regressions = 0;
+    std::fprintf(stderr, "\n%-40s %12s %12s %8s\n", "benchmark", "baseline", "current", "delta");
+    for (auto& r : g_results) {
+        auto it = base.find(r.name);
+        if (it == base.end()) continue;
+        double delta = (r.ns_per_op - it->second) / it->second * 100.0;
+        bool bad = delta > threshold_pct;
+        regressions += bad;
+        std::fprintf(stderr, "%-40s %12.1f %12.1f %+7.1f%%%s\n", r.name.c_str(),
+                     it->second, r.ns_per_op, delta, bad ? "  REGRESSION" : "");
+    }
+    std::fprintf(stderr, "%d regression(s) over %.0f%%\n", regressions, threshold_pct);
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    size_t      max_bytes = 64u << 20;
+    std::string out_path, baseline;
+    double      threshold = 10.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&] { return i + 1 < argc ? std::string(argv[++i]) : std::string(); };
+        if (a == "--max-bytes")      max_bytes = parse_size(next());
+        else if (a == "--filter")    g_filter  = next();
+        else if (a == "--out")       out_path  = next();
+        else if (a == "--compare")   baseline  = next();
+        else if (a == "--threshold") threshold = std::atof(next().c_str());
+        else {
+            std::fprintf(stderr, "usage: slate-bench [--max-bytes N[K|M|G]] [--filter s] "
+                                 "[--out f] [--compare baseline.json] [--threshold pct]\n");
+            return 2;
+        }
+    }
+
+    // Scratch dir doubles as HOME so the user's init.wren and plugins stay out.
+    fs::path dir = fs::temp_directory_path() / ("slate-bench-" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    setenv("HOME", dir.c_str(), 1);
+
+    std::vector<size_t> sizes;
+    for (size_t s = 1u << 10; s <= max_bytes; s <<= 5) sizes.push_back(s);
+    if (max_bytes >= (1u << 30) && sizes.back() != (1u << 30)) sizes.push_back(1u << 30);
+
+    for (size_t s : sizes) bench_buffer(dir, s);
+    {
+        VedApp app;
+        app.load_scripts();
+        for (size_t s : sizes) bench_search(app, std::min<size_t>(s, 64u << 20));
+        bench_render(app);
+        bench_wren(app);
+    }
+    fs::remove_all(dir);
+
+    if (out_path.empty()) {
+        write_json(std::cout);
+    } else {
+        std::ofstream f(out_path);
+        write_json(f);
+    }
+    return baseline.empty() ? 0 : compare(baseline, threshold);
+}
@@ -1,9 +1,17 @@
 #pragma once
+#include "batch.h"
+#include "jobs.h"
+#include "keymap.h"
+#include "keytrace.h"
+#include "perf.h"
 #include "screen_manager.h"
 #include "scripting.h"
+#include "timer.h"
+#include "worker.h"
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
+#include <deque>
 #include <functional>
 #include <unordered_map>
 #include <vector>
@@ -37,20 +45,63 @@ struct HighlightRule {
     std::regex  compiled;
 };
 
-struct WrenStatusSeg { WrenCallback cb; };
+// Patterns stay as text until a file with the extension is first drawn.
+struct HighlightRuleSet {
+    std::vector<std::pair<std::string, std::string>> pending; // pattern, type
+    std::vector<HighlightRule> compiled;
+};
+
+// A status segment's text is cached and its Wren fn re-run only when one of
+// its refresh triggers fires (or every every_ms, or on refresh_status_seg).
+enum SegRefresh : unsigned {
+    SEG_CHANGE = 1, SEG_SAVE = 2, SEG_MODE = 4,
+    SEG_OPEN   = 8,  // file opened or another buffer focused
+    SEG_CURSOR = 16, // every motion: opt-in only
+    SEG_EVENTS = SEG_CHANGE | SEG_SAVE | SEG_MODE | SEG_OPEN, // the default
+};
+
+struct WrenStatusSeg {
+    WrenCallback cb;
+    int          id = 0;
+    unsigned     refresh = SEG_EVENTS;
+    int          every_ms = 0;
+    bool         dirty = true;
+    std::string  text;
+};
 
 class VedApp {
 public:
     VedApp();
     void run();
+    // Boots the Wren VM and runs init.wren and plugins. run() does this after
+    // the first frame; headless callers invoke it directly. Idempotent.
+    void load_scripts();
+    // Headless: replays a key trace into an off-screen frame and prints the
+    // latency report (and writes it as JSON to report_path if given).
+    int  run_replay(const std::string& trace_path, const ReplayOptions& opts,
+                    const std::string& report_path);
+    // Headless: one file of a --batch run (see batch.h).
+    BatchResult batch_file(const std::string& path,
+                           const std::vector<BatchStep>& steps, bool save);
 
     void set_status(const std::string& msg) { editor.status_msg = msg; }
     void open_file(const std::string& path);
     void bind_command(const std::string& name, CommandHandler fn);
-    void bind_normal_key(const std::string& key, KeyHandler fn) { normal_keys_[key] = fn; }
+    bool run_command(const std::string& line); // "w", "!make"; false if unknown
+    // key may be a sequence ("gq"); a count repeats fn inside one transaction.
+    void bind_normal_key(const std::string& key, KeyHandler fn) {
+        normal_keys_[key] = fn;
+        keymap_dirty_ = true;
+    }
     void bind_insert_key(const std::string& key, KeyHandler fn) { insert_keys_[key] = fn; }
     void add_status_hook(RenderHook fn)  { status_hooks_.push_back(fn); }
     void add_overlay_hook(RenderHook fn) { overlay_hooks_.push_back(fn); }
+    // Lazy plugin activation: fn runs once, just before the first use of the
+    // command / normal-mode key, or when a file with the extension opens.
+    void add_command_trigger(const std::string& name, std::function<void()> fn);
+    void add_key_trigger(const std::string& key, std::function<void()> fn);
+    void add_ext_trigger(const std::string& ext, std::function<void()> fn);
+    std::string config_dir() const; // ~/.config/slate
 
     void bind_wren_command(const std::string& name, WrenHandle* r, WrenHandle* m);
     void bind_wren_key(const std::string& key, WrenHandle* r, WrenHandle* m);
@@ -62,10 +113,20 @@ public:
     void        set_line(int n, const std::string& s);
     void        insert_line(int n, const std::string& s);
     void        delete_line(int n);
+    // Batched forms: one change event per call; ranges are [start, end).
+    std::vector<std::string> get_lines(int start, int end);
+    void        set_lines(int start, std::vector<std::string> ls);
+    void        replace_range(int start, int end, std::vector<std::string> ls);
+    // Coalesce change events and undo snapshots on the focused buffer.
+    void        begin_transaction();
+    void        end_transaction();
+    // Ends open transactions until only 'keep' remain (an aborted callback).
+    void        unwind_transactions(size_t keep);
+    size_t      open_transactions() const { return txn_bufs_.size(); }
     std::string get_cursor();
     void        set_cursor(int row, int col);
     std::string get_yank_reg()                     { return yank_reg_; }
-    void        set_yank_reg(const std::string& s) { yank_reg_ = s; }
+    void        set_yank_reg(const std::string& s) { yank_reg_ = s; yank_kind_ = VisualKind::Line; }
     std::string get_mode_str();
     void        set_mode_str(const std::string& s);
     std::string get_search_query()                 { return search_query_; }
@@ -75,20 +136,66 @@ public:
     void        do_undo();
     void        do_redo();
     void        do_push_undo();
+    // Blocking, 2 s limit; kept for Slate.exec. Prefer the job API below.
     std::string exec_cmd(const std::string& cmd);
+    // fn(kind, data) gets ("stdout"|"stderr", chunk) then ("exit", code).
+    int         spawn_job(const std::string& cmd, WrenHandle* r, WrenHandle* m);
+    // Streams output into a new buffer named 'name' and shows it.
+    int         spawn_job_to_buffer(const std::string& cmd, const std::string& name);
+    bool        cancel_job(int id);
+    // Slate.async support: resume 'task' from the UI loop after ms, or once
+    // cmd exits (with a {code, stdout, stderr} Map). Takes the handle.
+    void        wake_task(WrenHandle* task, int ms);
+    void        await_job(WrenHandle* task, const std::string& cmd);
+    // Worker VMs on a thread pool; fn(msg) runs on the UI thread per post.
+    int         spawn_worker(const std::string& path, WrenHandle* r, WrenHandle* m);
+    bool        post_to_worker(int id, WorkerMsg msg);
+    bool        post_snapshot_to_worker(int id); // focused buffer's lines
+    bool        stop_worker(int id);
+    void        set_job_limit(int n);
+    int         job_count();
     void        save_file();
     void        close_buffer();
+    // Drops a buffer for good: close hooks run, then it leaves the list.
+    void        discard_buffer(const std::shared_ptr<Buffer>& buf);
+    // The buffer Slate buffer calls act on: the focused pane's, unless a
+    // callback about another buffer is running.
+    const std::shared_ptr<Buffer>& script_buffer();
     void        next_buffer();
     void        prev_buffer();
     void        new_buffer_named(const std::string& name);
 
     void bind_wren_insert_key(const std::string& key, WrenHandle* r, WrenHandle* m);
     void bind_wren_on_change(WrenHandle* r, WrenHandle* m);
+    // fn(ranges) once delay_ms pass without further edits; ranges are merged
+    // per buffer (see BufferChange), and Slate calls in fn act on that buffer.
+    void bind_wren_on_change_debounced(int delay_ms, WrenHandle* r, WrenHandle* m);
     void bind_wren_on_save(WrenHandle* r, WrenHandle* m);
     void bind_wren_on_open(WrenHandle* r, WrenHandle* m);
     void bind_wren_on_mode_change(WrenHandle* r, WrenHandle* m);
-    void add_wren_status_seg(WrenHandle* r, WrenHandle* m);
+    int  add_wren_status_seg(WrenHandle* r, WrenHandle* m,
+                             unsigned refresh = SEG_EVENTS, int every_ms = 0);
+    void refresh_status_seg(int id); // on demand; redraws
+    // Undoes and releases every Wren binding made by owner (a plugin name,
+    // "init", or a sourced path) and ends its parked tasks, Slate.spawn jobs
+    // and workers; used by :reload and :source.
+    void drop_bindings(const std::string& owner);
+    ScriptingEngine::VmStats vm_stats();
     void set_overlay(const std::string& text);
+    // Collect perf stats for the whole session and write them on exit.
+    void set_perf_dump(const std::string& path);
+
+    MemUsage    buffer_memory(); // focused buffer
+    MemUsage    total_memory();  // all buffers; editor state counts as caches
+
+    bool        add_fold(int start, int end);
+    void        delete_fold(int row);
+    void        open_fold(int row);
+    void        close_fold(int row);
+    void        toggle_fold(int row);
+    void        set_all_folds(bool closed);
+    std::string fold_at(int row);
+    bool        is_line_hidden(int row);
 
     void add_highlight_rule(const std::string& ext,
                             const std::string& pattern,
@@ -96,29 +203,82 @@ public:
     void clear_highlight_rules(const std::string& ext);
 
 private:
+    friend struct BenchAccess; // bench/bench.cpp
+
     void init_keybinds();
     void init_commands();
     void init_default_highlight_rules();
     void setup_buffer_hooks(Buffer& buf);
+    void finish_startup();
 
     // Returns current focused leaf's buffer (never null after init)
     Buffer& active_buf();
+    std::shared_ptr<Buffer> active_buf_ptr(); // null without a focused pane
+    void focus_batch_buffer(std::shared_ptr<Buffer> buf);
     int&    active_scroll();
 
     ftxui::Element render_pane(SplitNode& pane, int w, int h, bool focused);
     ftxui::Element render_split_tree(SplitNode& node, int w, int h);
     ftxui::Component build_editor();
     ftxui::Component build_bufferlist();
+    ftxui::Component build_memreport();
     ftxui::Component build_root();
 
    ftxui::Element render_line(const Buffer& buf, int row, const std::string& ext);
+    const std::vector<HighlightRule>* highlight_rules_for(const std::string& ext);
     static ftxui::Color token_color(const std::string& type);
     static std::string  file_ext(const std::string& path);
     ftxui::Element      make_overlay_elem();
+    ftxui::Element      make_perf_elem();
+    void                probe_flush();
 
+    struct SearchMatch { int row, col, len; };
     void do_search(const std::string& query);
+    void scan_search_line(const std::string& line, int row,
+                          std::vector<SearchMatch>& out);
+    void update_search_matches(Buffer& b, const BufferChange& c);
+    void own_binding(const std::string& kind, const std::string& name,
+                     WrenCallback cb, std::function<void()> undo, bool replaces = true);
+    uint64_t own_work(std::function<void()> stop);
+    bool     end_work(uint64_t id, std::string* owner = nullptr);
+    void invalidate_status_segs(unsigned trigger);
+    void schedule_status_timer(int id, int ms);
+    void queue_change(Buffer& b, const BufferChange& c);
+    void schedule_change_flush();
+    void flush_changes();
+    void schedule_indent_scan(const Buffer& b);
+    JobManager& jobs();
+    WorkerPool& workers();
+    using Triggers = std::unordered_map<std::string, std::vector<std::function<void()>>>;
+    static bool fire_triggers(Triggers& t, const std::string& key);
     void jump_next_match(Buffer& buf, int dir);
-    bool handle_pending(const std::string& key, Buffer& buf, Editor& ed);
+    void bind_builtin_key(const std::string& seq, KeyAction fn);
+    void build_keymap();
+    bool dispatch_normal_key(const std::string& key);
+    bool dispatch_event(const ftxui::Event& e);
+    bool handle_input(ftxui::Event e, int times);
+    void schedule_drain();
+    void drain_input();
+    bool is_leaf_key(const std::string& key);
+    void track_repeat(const ftxui::Event& e);
+    void track_repeat_done();
+    void stop_macro();
+    // Feeds keys straight to dispatch_event, times over, as one undo step and
+    // one change event on the focused buffer; nothing renders meanwhile.
+    void replay_keys(std::vector<ftxui::Event> keys, int times);
+    bool collect_paste(const ftxui::Event& e);
+    void paste_text(std::string text);
+    // Multiple cursors: motions move every cursor; edits in insert mode and
+    // x apply at all of them as one change event.
+    void bind_motion_key(const std::string& seq, void (*step)(Buffer&, int));
+    bool multi_cursor_edit(Buffer& buf, const ftxui::Event& e);
+    void add_cursor_at_next_match(Buffer& buf);
+    enum class VisualKind { Char, Line, Block };
+    void enter_visual(Buffer& buf, VisualKind kind);
+    // d / y / I / A over the selection, for each visual kind.
+    bool visual_edit(Buffer& buf, const std::string& k);
+    // p / P of a characterwise or block register, n copies side by side.
+    void put_inline(Buffer& buf, int after, int n);
 
     // ── State ────────────────────────────────────────────────────────────────
     std::unique_ptr<ScriptingEngine> scripting_;
@@ -128,6 +288,7 @@ private:
     std::unordered_map<std::string, KeyHandler>     normal_keys_;
     std::unordered_map<std::string, KeyHandler>     insert_keys_;
     std::unordered_map<std::string, CommandHandler> commands_;
+    Triggers command_triggers_, key_triggers_, ext_triggers_;
 
     Editor        editor;
     ScreenManager sm_;
@@ -135,18 +296,51 @@ private:
 
     std::string yank_reg_;
 
+    // Buffers with an open Slate transaction, innermost last
+    std::vector<std::shared_ptr<Buffer>> txn_bufs_;
+
     int visual_anchor_row_ = 0;
     int visual_anchor_col_ = 0;
+    // v / V / Ctrl-V; the yank register keeps the shape it was taken in
+    VisualKind visual_kind_ = VisualKind::Char;
+    VisualKind yank_kind_   = VisualKind::Line;
 
     std::string search_query_;
-    struct SearchMatch { int row, col, len; };
-    std::vector<SearchMatch> search_matches_;
+    std::regex  search_re_;          // compiled search_query_, if search_valid_
+    bool        search_valid_ = false;
+    std::weak_ptr<Buffer> search_buf_; // buffer search_matches_ belong to
+    std::vector<SearchMatch> search_matches_; // sorted by row, col
     int search_match_idx_ = -1;
 
-    std::string pending_key_;
+    std::string pending_key_; // visual-mode "zf"
     std::chrono::steady_clock::time_point pending_key_time_;
     static constexpr int PENDING_TIMEOUT_MS = 500;
 
+    // Normal mode: built-ins, then key triggers and normal_keys_ over them,
+    // compiled into keymap_ whenever one of those changes.
+    std::vector<std::pair<std::string, KeyAction>> builtin_keys_;
+    Keymap    keymap_;
+    KeyReader key_reader_{PENDING_TIMEOUT_MS};
+    bool      keymap_dirty_ = true;
+
+    // Macros (q{reg} ... q, @{reg}, @@) and '.': live events only; replays
+    // are neither recorded nor tracked.
+    std::unordered_map<std::string, std::vector<ftxui::Event>> macros_;
+    std::string               macro_reg_;   // recording into, if set
+    std::vector<ftxui::Event> macro_keys_;
+    std::string               last_macro_;  // for @@
+    std::vector<ftxui::Event> dot_keys_;    // last change, for '.'
+    std::vector<ftxui::Event> dot_cur_;     // the sequence in progress
+    bool                      dot_active_  = false;
+    const Buffer*             dot_buf_     = nullptr;
+    uint64_t                  dot_version_ = 0;
+    int                       replaying_   = 0; // nesting depth
+    static constexpr int      MAX_REPLAY_DEPTH = 16;
+
+    // Bracketed paste in progress: events up to the end marker land here.
+    bool        pasting_ = false;
+    std::string paste_buf_;
+
     // Ctrl+W prefix pending
     bool ctrl_w_pending_ = false;
 
@@ -155,11 +349,88 @@ private:
 
     int bufferlist_cursor_ = 0;
 
-    std::unordered_map<std::string, std::vector<HighlightRule>> highlight_rules_;
+    // :perf overlay; the probe times draw+flush after an event's frame
+    bool        perf_overlay_    = false;
+    bool        perf_hook_added_ = false;
+    bool        perf_probe_armed_ = false;
+    std::chrono::steady_clock::time_point perf_event_time_;
+    AllocTotals perf_event_allocs_;
+    std::string perf_dump_path_;
+
+    std::string trace_path_ = "slate-trace.json";
+
+    // :record, and the fixed frame size used by run_replay (0 = terminal)
+    KeyRecorder recorder_;
+    std::string record_path_ = "slate-keys.trace";
+    int         headless_w_ = 0, headless_h_ = 0;
+    bool        batch_ = false; // --batch: no background scans
+
+    std::unordered_map<std::string, HighlightRuleSet> highlight_rules_;
+
+    // Scripts load after the first frame; keys arriving before then wait here.
+    ftxui::Component          root_;
+    ftxui::Component          editor_view_; // build_editor(), made once
+    bool                      scripts_loaded_ = false;
+    bool                      startup_posted_ = false;
+    std::vector<ftxui::Event> startup_keys_;
+
+    // Live input waits here for drain_input (run() only; replays and tests
+    // dispatch directly). FRAME_MS bounds one drain before a redraw.
+    std::deque<ftxui::Event>  input_queue_;
+    bool                      coalesce_input_ = false;
+    bool                      drain_posted_   = false;
+    ftxui::Element            last_doc_;
+    static constexpr int      FRAME_MS = 16;
 
     WrenCallback wren_on_change_{};
     WrenCallback wren_on_save_{};
     WrenCallback wren_on_open_{};
     WrenCallback wren_on_mode_change_{};
     std::vector<WrenStatusSeg> wren_status_segs_;
+
+    // Owner of every Wren callback bound into the editor. 'undo' restores
+    // what the binding replaced (e.g. a built-in command it shadowed).
+    struct WrenBinding {
+        std::string           owner, kind, name;
+        WrenCallback          cb;
+        std::function<void()> undo;
+    };
+    std::vector<WrenBinding> wren_bindings_;
+    int                        next_status_seg_ = 1;
+    const Buffer*              status_buf_ = nullptr; // focused at last render
+    std::shared_ptr<Buffer>    script_buf_; // see script_buffer()
+
+    struct ChangeSub {
+        WrenCallback cb;
+        int          delay_ms = 0;
+        std::unordered_map<uint64_t, std::vector<BufferChange>> pending; // by Buffer::id
+        std::chrono::steady_clock::time_point due;
+    };
+    std::vector<ChangeSub> change_subs_;
+    uint64_t               change_timer_ = 0;
+
+    // Indentation folds are rescanned once edits to a buffer pause.
+    static constexpr int                   INDENT_RESCAN_MS = 300;
+    std::unordered_map<uint64_t, uint64_t> indent_timers_; // Buffer::id -> timer
+
+    // Async work a script started (a parked task, a Slate.spawn job, a
+    // worker), under the owner that started it. Entries leave when the work
+    // ends; drop_bindings runs 'stop' on whatever is left.
+    struct ScriptWork {
+        std::string           owner;
+        std::function<void()> stop;
+    };
+    std::unordered_map<uint64_t, ScriptWork> script_work_;
+    uint64_t                                 next_work_ = 1;
+
+    struct WorkerSub {
+        WrenCallback cb;
+        uint64_t     work = 0; // script_work_ entry
+    };
+    std::unordered_map<int, WorkerSub> worker_cbs_;
+
+    // Declared last: destroyed (threads joined) before the screen they post to.
+    std::unique_ptr<WorkerPool> workers_;
+    std::unique_ptr<JobManager> jobs_;
+    TimerQueue                  timers_;
 };
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// ── Batch mode ───────────────────────────────────────────────────────────────
+//   slate --batch [-j N] [--no-save] (-c ':cmd' | -s script.wren)... files...
+// Runs the steps, in order, against each file without a terminal, saves the
+// files that changed and exits non-zero if a step failed on any file. Files
+// are spread over N threads (default: one per core), each with its own
+// headless editor and Wren VM; init.wren, plugins and each -s script load
+// once per thread. A -s script runs as a function body, once per file.
+struct BatchStep {
+    bool        script = false; // else an ex command
+    std::string text;           // command line without the ':', or a path
+};
+
+struct BatchOptions {
+    std::vector<BatchStep>   steps;
+    std::vector<std::string> files;
+    int  jobs = 0; // 0: one per core
+    bool save = true;
+};
+
+struct BatchResult {
+    bool        changed = false;
+    std::string error; // empty on success
+};
+
+// Parses argv[first..]; false with err set on bad usage.
+bool parse_batch_args(int argc, char* argv[], int first, BatchOptions& out,
+                      std::string& err);
+// Prints one line per file that changed or failed, then a summary, to
+// stderr. Returns 0 if every file succeeded, else 1.
+int  run_batch(const BatchOptions& opts);
@@ -1,16 +1,58 @@
 #pragma once
+#include "fold.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
+#include <iterator>
 
 struct Buffer;
 using BufferEvent = std::function<void(Buffer&)>;
 
+// ── Change deltas ────────────────────────────────────────────────────────────
+// Lines [start, start + removed) of the old text became
+// [start, start + inserted) of the new text. An edit within one line is
+// {row, 1, 1}.
+struct BufferChange {
+    int start = 0, removed = 0, inserted = 0;
+    static BufferChange line(int row) { return {row, 1, 1}; }
+};
+
+using ChangeEvent = std::function<void(Buffer&, const BufferChange&)>;
+
+// Folds c, expressed against the text after every change already in 'ranges',
+// into that sorted list of disjoint ranges. Ranges c overlaps or touches are
+// merged with it; later ones shift. 'removed' counts stay relative to the
+// text before the first change.
+void merge_change(std::vector<BufferChange>& ranges, const BufferChange& c);
+// One range spanning a merged list (empty list: {0, 0, 0}).
+BufferChange cover(const std::vector<BufferChange>& ranges);
+
+struct Cursor {
+    int row = 0, col = 0;
+    bool operator<(const Cursor& o) const { return row != o.row ? row < o.row : col < o.col; }
+    bool operator==(const Cursor& o) const { return row == o.row && col == o.col; }
+};
+
 struct HistoryEntry {
     std::vector<std::string> lines;
     int cursor_row, cursor_col;
+    size_t bytes = 0; // heap footprint of 'lines', fixed once recorded
+};
+
+// ── Memory accounting ────────────────────────────────────────────────────────
+struct MemUsage {
+    size_t text   = 0; // live lines + names
+    size_t undo   = 0;
+    size_t redo   = 0;
+    size_t caches = 0; // fold tree and other derived state
+    size_t total() const { return text + undo + redo + caches; }
 };
 
+// Heap bytes held by a line vector (slots + out-of-line string storage).
+size_t lines_bytes(const std::vector<std::string>& lines);
+
 struct Buffer {
     std::string name;
     std::string filepath;
@@ -18,64 +60,213 @@ struct Buffer {
     int cursor_row = 0;
     int cursor_col = 0;
     bool modified = false;
+    // Unique for the process; unlike the address, never reused.
+    uint64_t id = next_id();
 
     Buffer(const std::string& n = "untitled") : name(n) {
         lines.push_back("");
     }
 
-    std::vector<BufferEvent> on_change;
+    std::vector<ChangeEvent> on_change;
     std::vector<BufferEvent> on_save;
     std::vector<BufferEvent> on_open;
     std::vector<BufferEvent> on_close;
     std::vector<BufferEvent> on_cursor_move;
 
-    void fire_change()      { for (auto& f : on_change)      f(*this); }
+    void fire_change(const BufferChange& c) {
+        if (cursors_placed_) cursors_placed_ = false;
+        else if (!cursors.empty()) adjust_cursors(c);
+        if (txn_depth_) {
+            merge_change(txn_changes_, c);
+            // Only the cover is fired; bounding the list keeps long macro
+            // replays linear.
+            if (txn_changes_.size() > TXN_MAX_RANGES)
+                txn_changes_.assign(1, cover(txn_changes_));
+            return;
+        }
+        ++version;
+        synced_lines_ = (int)lines.size();
+        for (auto& f : on_change) f(*this, c);
+    }
+    // Range unknown (undo, redo): everything since the last change event.
+    void fire_change() { fire_change({0, synced_lines_, (int)lines.size()}); }
     void fire_save()        { for (auto& f : on_save)        f(*this); }
     void fire_open()        { for (auto& f : on_open)        f(*this); }
     void fire_close()       { for (auto& f : on_close)       f(*this); }
     void fire_cursor_move() { for (auto& f : on_cursor_move) f(*this); }
 
     void load(const std::string& path);
-    void save();
+    bool save(); // false if there's no path or the write failed
     const std::string& current_line() const { return lines[cursor_row]; }
 
+    // ── Folds ───────────────────────────────────────────────────────────────
+    FoldTree folds;
+    uint64_t version = 0; // bumped on every change; tags background scans
+    int      synced_lines_ = 1; // line count as of the last change event
+
+    // Structural line edits go through these so folds shift with the text.
+    void insert_line(int at, std::string s) {
+        lines.insert(lines.begin() + at, std::move(s));
+        folds.shift(at, 1);
+    }
+    void erase_lines(int at, int n) {
+        lines.erase(lines.begin() + at, lines.begin() + at + n);
+        folds.shift(at, -n);
+    }
+    void insert_lines(int at, std::vector<std::string> ls) {
+        int n = (int)ls.size();
+        lines.insert(lines.begin() + at, std::make_move_iterator(ls.begin()),
+                     std::make_move_iterator(ls.end()));
+        folds.shift(at, n);
+    }
+
     // ── Undo / Redo ─────────────────────────────────────────────────────────
     static constexpr int MAX_UNDO = 200;
     std::vector<HistoryEntry> undo_stack_;
     std::vector<HistoryEntry> redo_stack_;
+    size_t undo_bytes_ = 0;
+    size_t redo_bytes_ = 0;
+
+    HistoryEntry snapshot() const {
+        HistoryEntry e{lines, cursor_row, cursor_col};
+        e.bytes = lines_bytes(e.lines);
+        return e;
+    }
 
     void push_undo() {
+        if (txn_depth_) return; // the transaction's own snapshot covers it
+        push_undo_entry(snapshot());
+    }
+
+    void push_undo_entry(HistoryEntry e) {
         redo_stack_.clear();
-        undo_stack_.push_back({lines, cursor_row, cursor_col});
-        if ((int)undo_stack_.size() > MAX_UNDO)
+        redo_bytes_ = 0;
+        undo_stack_.push_back(std::move(e));
+        undo_bytes_ += undo_stack_.back().bytes;
+        if ((int)undo_stack_.size() > MAX_UNDO) {
+            undo_bytes_ -= undo_stack_.front().bytes;
             undo_stack_.erase(undo_stack_.begin());
+        }
     }
 
     bool undo() {
         if (undo_stack_.empty()) return false;
-        redo_stack_.push_back({lines, cursor_row, cursor_col});
+        redo_stack_.push_back(snapshot());
+        redo_bytes_ += redo_stack_.back().bytes;
         auto e = std::move(undo_stack_.back());
         undo_stack_.pop_back();
+        undo_bytes_ -= e.bytes;
         lines      = std::move(e.lines);
         cursor_row = e.cursor_row;
         cursor_col = e.cursor_col;
         modified   = true;
+        folds.clamp((int)lines.size());
         return true;
     }
 
     bool redo() {
         if (redo_stack_.empty()) return false;
-        undo_stack_.push_back({lines, cursor_row, cursor_col});
+        undo_stack_.push_back(snapshot());
+        undo_bytes_ += undo_stack_.back().bytes;
         auto e = std::move(redo_stack_.back());
         redo_stack_.pop_back();
+        redo_bytes_ -= e.bytes;
         lines      = std::move(e.lines);
         cursor_row = e.cursor_row;
         cursor_col = e.cursor_col;
         modified   = true;
+        folds.clamp((int)lines.size());
         return true;
     }
 
+    // ── Transactions ────────────────────────────────────────────────────────
+    // Nestable. Inside one, fire_change only merges the range into the
+    // pending set and push_undo does nothing; committing the outermost level
+    // pushes the pre-transaction snapshot as one undo step and fires
+    // on_change once with the covering range.
+    void begin_txn() {
+        if (txn_depth_++ == 0) {
+            txn_snapshot_ = snapshot();
+            txn_changes_.clear();
+        }
+    }
+    void end_txn() {
+        if (txn_depth_ == 0 || --txn_depth_ > 0) return;
+        auto before = std::move(txn_snapshot_);
+        txn_snapshot_ = {};
+        if (txn_changes_.empty()) return;
+        auto c = cover(txn_changes_);
+        txn_changes_.clear();
+        push_undo_entry(std::move(before));
+        fire_change(c);
+    }
+    bool in_txn() const { return txn_depth_ > 0; }
+
+    static constexpr size_t   TXN_MAX_RANGES = 64;
+    int                       txn_depth_ = 0;
+    std::vector<BufferChange> txn_changes_;
+    HistoryEntry              txn_snapshot_{};
+
+    // Undo/redo totals are kept incrementally; text and caches are summed
+    // here, so the only always-on cost is one scan per undo snapshot.
+    MemUsage memory_usage() const;
+
+    // ── Ranges and blocks ───────────────────────────────────────────────────
+    // Characterwise spans run from 'from' up to, not including, 'to' and may
+    // cross lines ('\n'-joined). Blocks are columns [left, right) of rows
+    // lo..hi, clipped to each line. Each edit is one pass over its rows and
+    // returns the covering change for the caller to fire once.
+    std::string  text_range(Cursor from, Cursor to) const;
+    BufferChange erase_range(Cursor from, Cursor to);
+    // Inserts parts (one per line) at row/col; the cursor ends after them.
+    BufferChange insert_text(int row, int col, std::vector<std::string> parts);
+    std::vector<std::string> block_text(int lo, int hi, int left, int right) const;
+    BufferChange erase_block(int lo, int hi, int left, int right);
+    // Inserts block[i] at column col of row+i, padding short rows with spaces
+    // and adding rows past the end as needed. With count > 1 each row gets
+    // count copies side by side. Copies are padded to the block's width; the
+    // last one only where text follows it, so nothing trails at line ends.
+    BufferChange put_block(int row, int col, const std::vector<std::string>& block,
+                           int count = 1);
+
+    // ── Multiple cursors ────────────────────────────────────────────────────
+    // Secondary cursors; the primary stays cursor_row/cursor_col. The mc_*
+    // edits act at every cursor in one sorted pass, shifting later cursors on
+    // a line by what earlier ones inserted or removed, and return the
+    // covering change for the caller to fire once.
+    std::vector<Cursor> cursors; // sorted, distinct, never the primary
+
+    void clear_cursors() { cursors.clear(); }
+    void normalize_cursors(); // clamp, sort, drop duplicates
+    BufferChange mc_insert(const std::string& s);
+    BufferChange mc_backspace(); // a cursor at column 0 stays put
+    BufferChange mc_delete(int n); // n chars from each cursor; overlaps merge
+    BufferChange mc_newline();
+    // Follows an edit made some other way: later lines shift, cursors in
+    // removed lines move to the last line that replaced them.
+    void adjust_cursors(const BufferChange& c);
+
+    bool cursors_placed_ = false; // an mc_* edit already placed them
+
     // ── Helpers ──────────────────────────────────────────────────────────────
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> n{0};
+        return ++n;
+    }
+    // Vertical motion over visible lines; a closed fold counts as one line.
+    bool line_down() {
+        int r = folds.next_visible(cursor_row);
+        if (r >= (int)lines.size()) return false;
+        cursor_row = r;
+        return true;
+    }
+    bool line_up() {
+        int r = folds.prev_visible(cursor_row);
+        if (r < 0) return false;
+        cursor_row = r;
+        return true;
+    }
+
     void clamp_cursor() {
         if (cursor_row < 0) cursor_row = 0;
         if (cursor_row >= (int)lines.size()) cursor_row = (int)lines.size() - 1;
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+// ── Fold ranges ──────────────────────────────────────────────────────────────
+// A fold covers lines [start, end] (inclusive, end > start). When closed only
+// the start line is drawn; lines start+1..end are hidden. Folds are either
+// nested or disjoint, never crossing, and at most one fold starts per line.
+
+enum class FoldKind { Manual, Indent };
+
+struct FoldRange {
+    int      start  = 0;
+    int      end    = 0;
+    FoldKind kind   = FoldKind::Manual;
+    bool     closed = false;
+};
+
+// Indentation folds for a snapshot of lines (one pass, blank lines ignored).
+std::vector<FoldRange> compute_indent_folds(const std::vector<std::string>& lines);
+
+// ── FoldTree ─────────────────────────────────────────────────────────────────
+// Treap keyed by start line. Each subtree carries a lazy line offset so
+// inserting or erasing lines shifts every fold below the edit in O(log n),
+// plus max-end aggregates so stabbing queries ("which fold hides row r")
+// descend a single path instead of scanning.
+class FoldTree {
+public:
+    FoldTree() = default;
+    FoldTree(FoldTree&&) = default;
+    FoldTree& operator=(FoldTree&&) = default;
+
+    // Returns false if [start, end] would cross an existing fold.
+    bool add(int start, int end, FoldKind kind = FoldKind::Manual,
+             bool closed = false);
+    // Remove the innermost fold containing row.
+    bool remove(int row);
+    void clear();
+    // Drop folds that reach past the last line (after wholesale text swaps).
+    void clamp(int line_count);
+
+    // Innermost fold containing row; false if none.
+    bool innermost(int row, FoldRange& out) const;
+    bool set_closed(int row, bool closed);  // innermost fold containing row
+    bool toggle(int row);
+    void set_all_closed(bool closed);
+
+    // Row itself if visible, else the header line of the closed fold hiding it.
+    int  visible_row(int row) const;
+    bool is_hidden(int row) const { return visible_row(row) != row; }
+    // Line after row, skipping the body of a closed fold headed at row.
+    int  next_visible(int row) const;
+    // Visible line before row (may be negative when row is the first line).
+    int  prev_visible(int row) const { return row <= 0 ? -1 : visible_row(row - 1); }
+    // Last hidden line of the closed fold headed at row, or -1.
+    int  closed_end_at(int row) const;
+
+    // Lines inserted (delta > 0) or erased (delta < 0) starting at line 'at'.
+    void shift(int at, int delta);
+
+    std::vector<FoldRange> ranges() const;
+    size_t size() const  { return count_; }
+    bool   empty() const { return count_ == 0; }
+    bool   any_closed() const;
+    size_t memory_bytes() const {
+        return pool_.capacity() * sizeof(Node) + free_.capacity() * sizeof(int);
+    }
+
+    // ── Indentation folds ────────────────────────────────────────────────
+    // Start a background scan of a snapshot of lines for this version. With
+    // a scan already running, a fresh one starts once that finishes.
+    void request_indent(const std::vector<std::string>& lines, uint64_t version);
+    // Install a finished background scan, if any, without blocking. Between
+    // scans, shift() keeps the installed folds in line with edits.
+    void poll_indent(const std::vector<std::string>& lines, uint64_t version);
+    // Make indent folds current for version, waiting for or running a scan.
+    void sync_indent(const std::vector<std::string>& lines, uint64_t version);
+
+private:
+    struct Node {
+        FoldRange r;
+        uint32_t  prio = 0;
+        int       left = -1, right = -1;
+        int       lazy = 0;
+        int       max_end = 0;         // over subtree
+        int       max_closed_end = 0;  // over closed folds in subtree, NONE if none
+    };
+    static constexpr int NONE = -(1 << 30);
+
+    std::vector<Node> pool_;
+    std::vector<int>  free_;
+    int      root_  = -1;
+    size_t   count_ = 0;
+    uint32_t seed_  = 0x9e3779b9u;
+
+    // Fed by a detached thread, so dropping it (closing the buffer) never
+    // waits for the scan.
+    std::future<std::vector<FoldRange>> indent_job_;
+    uint64_t indent_job_version_ = 0;
+    uint64_t indent_version_     = UINT64_MAX;
+    bool     indent_rerun_       = false; // requested while a scan ran
+
+    int  alloc(const FoldRange& r);
+    void release(int n);
+    void apply(int n, int d);
+    void push(int n);
+    void pull(int n);
+    void split(int t, int key, int& l, int& r); // l: start < key
+    int  merge(int l, int r);
+    // Const lookups carry the pending lazy offset of the path as 'off'.
+    struct Hit { int n = -1; int off = 0; };
+    Hit  find(int key) const;
+    Hit  innermost_node(int t, int off, int row) const;
+    Hit  outermost_closed(int t, int off, int row) const;
+    FoldRange at(const Hit& h) const;
+    // Detach the node keyed at start, let fn edit it, and re-link it.
+    template <class Fn> bool edit(int start, Fn fn);
+    void shift_ends(int t, int at, int delta, std::vector<int>& degenerate);
+    void mark_closed(int t, bool closed);
+    void collect(int t, int lazy, std::vector<FoldRange>& out) const;
+    void free_subtree(int t);
+    void install_indent(std::vector<FoldRange> fresh, uint64_t version);
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+// ── Jobs ─────────────────────────────────────────────────────────────────────
+// Shell commands run without blocking the UI. A reactor thread polls every
+// running job's stdout/stderr and hands chunks (not line-aligned) and the
+// exit status to the job's handlers via 'post', which must marshal them onto
+// the UI loop. At most max_running jobs run at once; the rest wait in FIFO
+// order. Each job runs in its own process group so cancel() reaches its
+// children too.
+
+enum class JobStream { Stdout, Stderr };
+
+struct JobHandlers {
+    std::function<void(JobStream, const std::string&)> on_output;
+    // Exit code, 128 + signal if killed, or -1 if it never ran.
+    std::function<void(int)> on_exit;
+};
+
+struct JobInfo {
+    int         id;
+    std::string cmd;
+    bool        running; // false: still queued
+};
+
+class JobManager {
+public:
+    using Post = std::function<void(std::function<void()>)>;
+
+    explicit JobManager(Post post, int max_running = 8);
+    ~JobManager(); // kills what is still running
+    JobManager(const JobManager&) = delete;
+    JobManager& operator=(const JobManager&) = delete;
+
+    int  spawn(const std::string& cmd, JobHandlers handlers); // id > 0
+    // SIGTERM to a running job's group, or drops a queued one (exit -1).
+    bool cancel(int id);
+    void set_max_running(int n);
+    std::vector<JobInfo> list() const;
+
+private:
+    struct Job {
+        int         id = 0;
+        std::string cmd;
+        JobHandlers handlers;
+        pid_t       pid = -1;
+        int         out = -1, err = -1; // reactor thread only
+    };
+
+    void reactor();
+    bool start(const std::shared_ptr<Job>& job);
+    void wake();
+    void finish(const std::shared_ptr<Job>& job, int status);
+
+    Post                                 post_;
+    mutable std::mutex                   mu_;
+    std::deque<std::shared_ptr<Job>>     queued_;
+    std::map<int, std::shared_ptr<Job>>  running_;
+    int                                  max_running_;
+    int                                  next_id_ = 1;
+    bool                                 stop_ = false;
+    int                                  wake_[2] = {-1, -1};
+    std::thread                          thread_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Buffer;
+struct Editor;
+
+// ── Keymap ───────────────────────────────────────────────────────────────────
+// Normal-mode key sequences ("j", "dd", "zo") in a trie. An action gets the
+// count typed before its sequence (0 if none) and applies it in one go:
+// "5000j" is one cursor move, "300dd" one erase and one undo step.
+using KeyAction = std::function<void(Buffer&, Editor&, int count)>;
+
+// One key per UTF-8 character: "zo" -> {"z", "o"}.
+std::vector<std::string> split_keys(const std::string& seq);
+
+class Keymap {
+public:
+    static constexpr int ROOT = 0;
+
+    void bind(const std::string& seq, KeyAction fn); // replaces
+    void clear() { nodes_.assign(1, Node{}); }
+
+    int  next(int node, const std::string& key) const; // -1: no such key
+    bool has_next(int node) const { return !nodes_[node].next.empty(); }
+    const KeyAction* action(int node) const;           // null: prefix only
+    const KeyAction* find(const std::string& seq) const;
+
+private:
+    struct Node {
+        std::unordered_map<std::string, int> next;
+        KeyAction action;
+    };
+    std::vector<Node> nodes_ = std::vector<Node>(1);
+};
+
+// ── KeyReader ────────────────────────────────────────────────────────────────
+// Walks a Keymap one key at a time: an optional count, then a sequence. A
+// partial sequence, or one that is also the prefix of a longer binding,
+// waits up to timeout_ms for its next key.
+class KeyReader {
+public:
+    static constexpr int MAX_COUNT = 999999;
+
+    struct Result {
+        KeyAction action;      // to run, if set (a copy: it may rebind keys)
+        int  count    = 0;
+        bool consumed = true;  // false: unbound, let the key fall through
+        bool again    = false; // after the action, feed the same key again
+    };
+
+    explicit KeyReader(int timeout_ms) : timeout_ms_(timeout_ms) {}
+
+    Result feed(const Keymap& km, const std::string& key);
+    // The count typed so far, for keys handled outside the keymap; resets.
+    int  take_count();
+    void reset() { node_ = Keymap::ROOT; count_ = 0; }
+    // The keymap was rebuilt: node ids are stale, the count still holds.
+    void restart() { node_ = Keymap::ROOT; }
+    bool pending() const { return node_ != Keymap::ROOT || count_ > 0; }
+
+private:
+    int node_  = Keymap::ROOT;
+    int count_ = 0;
+    int timeout_ms_;
+    std::chrono::steady_clock::time_point last_;
+};
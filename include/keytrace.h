@@ -0,0 +1,71 @@
+#pragma once
+#include <ftxui/component/component_base.hpp>
+#include <ftxui/component/event.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ── Key traces ───────────────────────────────────────────────────────────────
+// A recorded input session. On disk, one event per line:
+//
+//   <delay_us> <c|s> <hex of Event::input()>
+//
+// 'c' events replay as Event::Character, 's' as Event::Special. Mouse and
+// terminal-report events are not recorded.
+struct KeyTraceEvent {
+    uint64_t    delay_us = 0; // since the previous event
+    bool        character = false;
+    std::string input;
+};
+
+ftxui::Event to_event(const KeyTraceEvent& k);
+
+bool save_key_trace(const std::string& path, const std::vector<KeyTraceEvent>& events);
+// False if the file can't be read or has a malformed line (reported in err).
+bool load_key_trace(const std::string& path, std::vector<KeyTraceEvent>& events,
+                    std::string& err);
+
+// Captures events from the root CatchEvent while :record is active.
+class KeyRecorder {
+public:
+    bool active() const { return active_; }
+    void start();
+    void note(const ftxui::Event& e);
+    // Stops and writes the trace; false if the file failed.
+    bool stop(const std::string& path);
+    size_t size() const { return events_.size(); }
+
+private:
+    bool active_ = false;
+    std::vector<KeyTraceEvent> events_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+// ── Replay ───────────────────────────────────────────────────────────────────
+// Feeds events to a component and renders each resulting frame into an
+// off-screen Screen of fixed size; an event's latency covers OnEvent, Render
+// and serialising the frame to terminal output.
+struct ReplayReport {
+    size_t events = 0;
+    double total_ms = 0; // excludes realtime sleeps
+    double mean_us = 0, p50_us = 0, p95_us = 0, p99_us = 0, max_us = 0;
+    std::vector<double> latency_us; // per event, in trace order
+
+    double events_per_s() const { return total_ms > 0 ? events * 1000.0 / total_ms : 0; }
+    std::string summary() const;
+    std::string to_json() const;
+};
+
+struct ReplayOptions {
+    int  width = 120, height = 40;
+    bool realtime = false; // sleep the recorded gaps between events
+};
+
+// 'done' is polled after every event; returning true ends the replay early
+// (e.g. once the editor has quit).
+ReplayReport replay_key_trace(ftxui::Component root,
+                              const std::vector<KeyTraceEvent>& events,
+                              const ReplayOptions& opts,
+                              const std::function<bool()>& done = {});
@@ -0,0 +1,193 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ── Phases ───────────────────────────────────────────────────────────────────
+// Timings are inclusive: a Wren callback run from a key handler counts towards
+// both Script and Event.
+enum class PerfPhase {
+    Event,       // CatchEvent dispatch
+    Script,      // ScriptingEngine::call*
+    Render,      // render_split_tree
+    RenderLine,  // render_line (per visible line)
+    Flush,       // layout + terminal write after our renderer returns
+    Keystroke,   // event received -> frame flushed
+    Count
+};
+
+const char* perf_phase_name(PerfPhase p);
+
+// ── Allocation counting ──────────────────────────────────────────────────────
+// Only populated in builds configured with -Dalloc_stats=true, which replace
+// global operator new/delete (src/alloc_stats.cpp). Allocations are charged to
+// the innermost PerfScope phase on the allocating thread; index Count collects
+// everything outside a scope.
+#ifdef SLATE_ALLOC_STATS
+constexpr bool kAllocStats = true;
+#else
+constexpr bool kAllocStats = false;
+#endif
+
+struct AllocTotals {
+    uint64_t allocs = 0, frees = 0, bytes = 0;
+};
+
+void        alloc_note_new(size_t bytes);
+void        alloc_note_delete();
+AllocTotals alloc_totals(int phase); // 0..Count
+AllocTotals alloc_totals_all();
+void        alloc_reset();
+int         alloc_phase();
+void        set_alloc_phase(int phase);
+
+struct PerfSummary {
+    uint64_t count = 0;   // lifetime samples
+    double   mean_us = 0; // lifetime
+    double   p50_us = 0, p95_us = 0, p99_us = 0; // rolling window
+    double   max_us = 0;  // lifetime
+};
+
+// ── PerfStats ────────────────────────────────────────────────────────────────
+// Per-phase rolling sample window (for percentiles) plus a lifetime log2
+// histogram (for dumps). Recording is a ring-buffer store; nothing is sorted
+// until a summary is asked for. UI thread only.
+class PerfStats {
+public:
+    static constexpr int WINDOW  = 1024;
+    static constexpr int BUCKETS = 40; // bucket i holds samples < 2^(i+1) ns
+
+    bool enabled() const { return enabled_; }
+    void set_enabled(bool on) { enabled_ = on; }
+    void reset();
+
+    void record(PerfPhase p, std::chrono::nanoseconds d);
+    PerfSummary summary(PerfPhase p) const;
+
+    // Allocations made between an event arriving and its frame being flushed.
+    void record_keystroke_allocs(const AllocTotals& delta);
+    AllocTotals keystroke_allocs_last() const { return key_allocs_last_; }
+    AllocTotals keystroke_allocs_mean() const;
+
+    // JSON object with summaries and lifetime histograms for every phase.
+    std::string to_json() const;
+    bool dump(const std::string& path) const;
+
+private:
+    struct Series {
+        std::array<uint64_t, WINDOW>  window{};
+        std::array<uint64_t, BUCKETS> buckets{};
+        uint64_t count = 0, total_ns = 0, max_ns = 0;
+    };
+    bool enabled_ = false;
+    std::array<Series, (size_t)PerfPhase::Count> series_{};
+    AllocTotals key_allocs_last_, key_allocs_sum_;
+    uint64_t    keys_ = 0;
+};
+
+PerfStats& perf_stats();
+
+// ── PerfScope ────────────────────────────────────────────────────────────────
+// Times the enclosing scope into a phase; a single bool test when disabled.
+class PerfScope {
+public:
+    explicit PerfScope(PerfPhase p) : phase_(p), on_(perf_stats().enabled()) {
+        if (kAllocStats) {
+            prev_alloc_phase_ = alloc_phase();
+            set_alloc_phase((int)p);
+        }
+        if (on_) t0_ = std::chrono::steady_clock::now();
+    }
+    ~PerfScope() {
+        if (on_) perf_stats().record(phase_, std::chrono::steady_clock::now() - t0_);
+        if (kAllocStats) set_alloc_phase(prev_alloc_phase_);
+    }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfPhase phase_;
+    bool      on_;
+    int       prev_alloc_phase_ = (int)PerfPhase::Count;
+    std::chrono::steady_clock::time_point t0_;
+};
+
+// ── Callback profile ─────────────────────────────────────────────────────────
+// Cost of each Wren callback the editor calls, keyed by its receiver handle
+// and labelled with the owning plugin and the binding that registered it.
+// Always on (two clock reads and a lookup per call). UI thread only.
+struct CallbackStats {
+    std::string owner, kind;  // e.g. "git", "bindOnSave"
+    uint64_t calls = 0, total_ns = 0, max_ns = 0;
+    uint64_t vm_bytes = 0;    // allocated by Wren during the calls
+    int      strikes = 0;     // watchdog overruns
+    bool     disabled = false;
+};
+
+class CallbackProfiler {
+public:
+    // (Re)starts the entry for key, under the current owner unless given.
+    void tag(const void* key, const std::string& kind, const std::string& owner = {});
+    // True if the call went over budget (and a budget is set).
+    bool record(const void* key, uint64_t ns, uint64_t vm_bytes);
+    void forget(const void* key) { stats_.erase(key); }
+    const CallbackStats* find(const void* key) const;
+    void reset(); // zeroes counters and strikes, keeps tags
+
+    // Plugin being loaded or whose callback is running; bindings made
+    // meanwhile belong to it.
+    const std::string& owner() const { return owner_; }
+    void set_owner(std::string o) { owner_ = std::move(o); }
+
+    double budget_ms() const { return budget_ms_; }
+    void   set_budget_ms(double ms) { budget_ms_ = ms; } // 0 = off
+
+    // Budget per outermost callback, checked by ScriptingEngine at Slate
+    // calls (not inside Wren's loop); after max_strikes overruns a callback
+    // is disabled until reset().
+    double watchdog_ms() const { return watchdog_ms_; }
+    void   set_watchdog_ms(double ms) { watchdog_ms_ = ms; } // 0 = off
+    int    max_strikes() const { return max_strikes_; }
+    void   set_max_strikes(int n) { max_strikes_ = n > 0 ? n : 1; }
+    bool   strike(const void* key); // true if this strike disabled it
+    bool   disabled(const void* key) const {
+        auto it = stats_.find(key);
+        return it != stats_.end() && it->second.disabled;
+    }
+
+    std::vector<CallbackStats> by_cost() const; // total time, descending
+    std::string report() const;
+
+private:
+    std::unordered_map<const void*, CallbackStats> stats_;
+    std::string owner_ = "init";
+    double      budget_ms_ = 0;
+    double      watchdog_ms_ = 250;
+    int         max_strikes_ = 3;
+};
+
+CallbackProfiler& callback_profiler();
+
+// ── Startup profile ──────────────────────────────────────────────────────────
+// Wall time from main() split at mark() calls; each mark closes the phase that
+// ends there. Milestones record the cumulative time at that point. Printed on
+// exit with --startup-profile.
+class StartupProfile {
+public:
+    void begin();
+    void mark(const char* phase);
+    void milestone(const char* name);
+    std::string report() const;
+
+private:
+    struct Entry { const char* name; double ms; bool milestone; };
+    std::thread::id owner_; // begin()'s thread; others (--batch) don't record
+    std::chrono::steady_clock::time_point start_, last_;
+    std::vector<Entry> entries_;
+};
+
+StartupProfile& startup_profile();
@@ -4,7 +4,7 @@
 #include <memory>
 #include <functional>
 
-enum class ScreenType { Editor, BufferList };
+enum class ScreenType { Editor, BufferList, MemReport };
 
 // ── Split tree ────────────────────────────────────────────────────────────────
 enum class SplitDir { None, Vertical, Horizontal };
@@ -1,9 +1,18 @@
 #pragma once
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <wren.hpp>
 
 class VedApp;
+struct BufferChange;
+struct WorkerMsg;
+
+// Module name an import resolves to: a canonical file path for "./x", "../x"
+// (relative to importer) and bare names found in modules_dir, else name.
+std::string resolve_module_name(const std::string& importer, const std::string& name,
+                                const std::string& modules_dir);
 
 struct WrenCallback {
     WrenHandle* receiver = nullptr;
@@ -16,28 +25,100 @@ public:
     ScriptingEngine(VedApp& app);
     ~ScriptingEngine();
 
-    void load_file(const std::string& path);
+    bool load_file(const std::string& path); // false: missing or failed
+    // Loads plugins/<name>/main.wren now, or on first use of the triggers
+    // listed in plugins/<name>/manifest (see scripting.cpp).
     void load_plugins_dir(const std::string& dir);
     void error(const std::string& msg);
 
+    // Drops everything 'owner' bound (VedApp::drop_bindings) and runs its
+    // script again; owner is a plugin name or "init". False if unknown.
+    bool reload(const std::string& owner);
+    // Runs a file with its path as owner, replacing its previous bindings.
+    bool source(const std::string& path);
+    // Batch -s step: like source, but the script compiles once per VM, as a
+    // function body, and each later run only calls it.
+    bool run_batch_script(const std::string& path);
+
+    // Every handle handed to VedApp must come back here.
+    void release(WrenHandle* h);
+    void release(WrenCallback& cb); // both handles; cb is cleared
+
+    struct VmStats {
+        size_t   heap_bytes = 0, heap_peak = 0; // all VMs in the process
+        uint64_t allocs = 0, frees = 0;          // reallocate calls, all VMs
+        size_t   live_handles = 0;               // held by the editor
+        uint64_t gc_runs = 0;                    // collect_garbage calls
+        double   gc_last_ms = 0;
+    };
+    VmStats vm_stats() const;
+    // Full collection; returns the pause in ms. Wren's own automatic
+    // collections aren't visible through the embedding API.
+    double  collect_garbage();
+
     // call fn(arg) — one string arg, no return value used
     void call(WrenCallback& cb, const std::string& arg);
     // call fn() — zero args, no return value used
     void call0(WrenCallback& cb);
     // call fn(a, b) — two string args, no return value used
     void call2(WrenCallback& cb, const std::string& a, const std::string& b);
+    // call fn(a, n) — a string and a Num, no return value used
+    void call2(WrenCallback& cb, const std::string& a, double n);
     // call fn() — zero args, return string from slot 0
     std::string call_str(WrenCallback& cb);
+    // call fn(list) — a List of {"start", "removed", "inserted"} Maps
+    void call_changes(WrenCallback& cb, const std::vector<BufferChange>& changes);
+    // call fn(msg) — a message posted by a worker VM
+    void call_msg(WrenCallback& cb, const WorkerMsg& msg);
+
+    // Resumes a suspended Slate.async task; 'value' fills the slot returned
+    // by the Slate call it is parked in (null if empty). Releases 'task'.
+    // 'owner' is who started the task; what it binds or parks is theirs.
+    using SlotWriter = std::function<void(WrenVM*, int slot)>;
+    void resume_task(WrenHandle* task, const SlotWriter& value = {},
+                     const std::string& owner = {});
+
+    struct Plugin {
+        std::string name, main;
+        std::vector<std::string> commands, keys, exts; // activation triggers
+        bool startup = false;
+        bool loaded  = false;
+        bool lazy() const { return !commands.empty() || !keys.empty() || !exts.empty(); }
+    };
+    const std::vector<Plugin>& plugins() const { return plugins_; }
+    // Imported module files read so far (each compiles once per VM).
+    static size_t modules_loaded();
 
     WrenVM* vm() { return vm_; }
+    // Compile and runtime errors reported by editor VMs on this thread.
+    static uint64_t error_count();
+
+    // Live and peak bytes allocated by Wren (all VMs in the process).
+    static size_t heap_bytes();
+    static size_t heap_peak();
+    static void*  reallocate(void* memory, size_t new_size, void* user_data);
+    // Reads a resolved module file (shared with worker VMs).
+    static WrenLoadModuleResult load_module(WrenVM* vm, const char* name);
 
 private:
     VedApp& app_;
     WrenVM* vm_ = nullptr;
+    WrenHandle* slate_class_   = nullptr;
+    WrenHandle* resume_method_ = nullptr; // Slate.resume_(_,_)
+    std::vector<Plugin> plugins_;
+    std::unordered_map<std::string, int> load_counts_; // by path, for reloads
+    std::unordered_map<std::string, WrenHandle*> batch_fns_; // by path
+    WrenHandle* call_fn_ = nullptr; // call()
+    uint64_t gc_runs_    = 0;
+    double   gc_last_ms_ = 0;
+
+    void activate(size_t plugin);
+    bool run_as(const std::string& owner, const std::string& path);
 
     void init_vm();
     static WrenForeignMethodFn bind_method(WrenVM* vm, const char* module,
         const char* class_name, bool is_static, const char* signature);
+    static const char* resolve_module(WrenVM* vm, const char* importer, const char* name);
     static void write(WrenVM* vm, const char* text);
     static void error_handler(WrenVM* vm, WrenErrorType type,
         const char* module, int line, const char* msg);
@@ -0,0 +1,41 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// ── TimerQueue ───────────────────────────────────────────────────────────────
+// One background thread that runs callbacks at their deadlines. Callbacks run
+// on that thread, so anything touching editor state must be posted back to
+// the UI loop (ScreenInteractive::Post). The thread starts on first use.
+class TimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerQueue() = default;
+    ~TimerQueue();
+    TimerQueue(const TimerQueue&) = delete;
+    TimerQueue& operator=(const TimerQueue&) = delete;
+
+    // Returns an id for cancel(); never 0.
+    uint64_t schedule(Clock::duration delay, std::function<void()> fn);
+    // No-op if the timer already fired or was cancelled.
+    void cancel(uint64_t id);
+
+private:
+    using Key = std::pair<Clock::time_point, uint64_t>;
+
+    void run();
+
+    std::mutex                             mu_;
+    std::condition_variable                cv_;
+    std::map<Key, std::function<void()>>   queue_; // ordered by deadline
+    std::unordered_map<uint64_t, Clock::time_point> due_;
+    uint64_t                               next_id_ = 1;
+    bool                                   stop_ = false;
+    std::thread                            thread_;
+};
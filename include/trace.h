@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// ── Tracing ──────────────────────────────────────────────────────────────────
+// Scoped trace points recorded into a per-thread ring buffer and written out
+// as Chrome trace-event JSON (chrome://tracing, Perfetto). When tracing is off
+// a TraceScope costs one relaxed atomic load.
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool trace_enabled() {
+    return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// Clears every thread's ring and starts recording.
+void trace_start();
+// Stops recording and writes the collected events. False if the file failed.
+bool trace_stop(const std::string& path);
+
+// name must be a string literal (only the pointer is stored).
+void trace_record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+uint64_t trace_now_ns();
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name_(name), on_(trace_enabled()) {
+        if (on_) t0_ = trace_now_ns();
+    }
+    ~TraceScope() {
+        if (on_) trace_record(name_, t0_, trace_now_ns());
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    bool        on_;
+    uint64_t    t0_ = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct WrenVM;
+
+// ── Worker messages ──────────────────────────────────────────────────────────
+// What crosses between the editor VM and worker VMs: null, Bool, Num, String,
+// Lists of those, and buffer snapshots. A snapshot shares the editor's copy
+// of the lines and becomes a List of Strings only inside the receiving VM.
+struct WorkerMsg {
+    enum Kind { Null, Bool, Num, Str, List, Lines } kind = Null;
+    double                  num = 0; // Bool and Num
+    std::string             str;
+    std::vector<WorkerMsg>  list;
+    std::shared_ptr<const std::vector<std::string>> lines;
+};
+
+// Slot-level conversion; both use the slots above 'slot' as scratch and
+// ensure enough of them. read_worker_msg fails (err set) on other types.
+bool read_worker_msg(WrenVM* vm, int slot, WorkerMsg& out, std::string& err);
+void write_worker_msg(WrenVM* vm, int slot, const WorkerMsg& msg);
+
+// ── WorkerPool ───────────────────────────────────────────────────────────────
+// Each worker is its own WrenVM running one script, with a mailbox. A worker
+// with mail is queued for the pool's threads, which run it until the mailbox
+// is drained (a bounded slice at a time), so one VM never runs on two threads
+// at once but many workers use many cores. Inside the script:
+//
+//   import "worker" for Worker
+//   Worker.onMessage {|msg| Worker.post(result) }
+//
+// Posts and errors reach the handlers through 'post', which must marshal
+// them onto the UI loop.
+struct WorkerHandlers {
+    std::function<void(int id, WorkerMsg msg)>          on_message;
+    std::function<void(int id, const std::string& err)> on_error;
+};
+
+class WorkerPool {
+public:
+    using Post = std::function<void(std::function<void()>)>;
+
+    WorkerPool(Post post, WorkerHandlers handlers, int threads = 0); // 0: cores - 1
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Starts 'path' in a new VM; imports resolve against it and modules_dir.
+    int  spawn(const std::string& path, const std::string& modules_dir); // id > 0
+    bool send(int id, WorkerMsg msg);
+    bool stop(int id); // pending mail is dropped; a running slice finishes
+    size_t size() const;
+
+    struct Worker; // worker.cpp
+    struct Shared; // worker.cpp
+
+private:
+    static void run_thread(std::shared_ptr<Shared> s);
+    static void run_slice(Shared& s, const std::shared_ptr<Worker>& w);
+
+    // What the pool threads touch lives in Shared, which each thread co-owns:
+    // at shutdown a thread stuck in a script is detached, not joined, and may
+    // outlive the pool. After shutdown nothing more is posted.
+    std::shared_ptr<Shared>  s_;
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,35 @@
+// alloc_stats.cpp — counting replacements for global operator new/delete.
+// Only compiled with -Dalloc_stats=true; see alloc_note_new in perf.cpp.
+#include "perf.h"
+#include <cstdlib>
+#include <new>
+
+static void* counted_alloc(std::size_t n) {
+    alloc_note_new(n);
+    return std::malloc(n ? n : 1);
+}
+
+void* operator new(std::size_t n) {
+    if (void* p = counted_alloc(n)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n) {
+    if (void* p = counted_alloc(n)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept   { return counted_alloc(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return counted_alloc(n); }
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    alloc_note_delete();
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept                           { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept                { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept              { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept      { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept    { operator delete(p); }
@@ -1,9 +1,12 @@
 // app.cpp — Slate editor with split pane support
 #include "app.h"
 #include "scripting.h"
+#include "trace.h"
 #include <algorithm>
 #include <cctype>
 #include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/component_options.hpp>
 #include <ftxui/component/event.hpp>
@@ -12,6 +15,7 @@
 #include <sstream>
 #include <sys/select.h>
 #include <unistd.h>
+#include <utility>
 
 using namespace ftxui;
 
@@ -35,6 +39,19 @@ static std::string mode_to_str(EditorMode m) {
   return "normal";
 }
 
+static std::string human_bytes(size_t n) {
+  const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+  double v = (double)n;
+  int u = 0;
+  while (v >= 1024.0 && u < 4) {
+    v /= 1024.0;
+    ++u;
+  }
+  char out[32];
+  std::snprintf(out, sizeof(out), u ? "%.1f %s" : "%.0f %s", v, units[u]);
+  return out;
+}
+
 static std::string leading_ws(const std::string &s) {
   size_t i = 0;
   while (i < s.size() && (s[i] == ' ' || s[i] == '\t'))
@@ -42,6 +59,95 @@ static std::string leading_ws(const std::string &s) {
   return s.substr(0, i);
 }
 
+// Bracketed paste markers (xterm mode 2004).
+static const std::string kPasteBegin = "\x1b[200~";
+static const std::string kPasteEnd = "\x1b[201~";
+
+// The yank register holds whole lines, '\n'-separated.
+static std::string join_lines(const std::vector<std::string> &lines, int start,
+                              int end) {
+  std::string out;
+  for (int r = start; r < end; ++r) {
+    if (r > start)
+      out += '\n';
+    out += lines[r];
+  }
+  return out;
+}
+
+static std::vector<std::string> split_lines(const std::string &s) {
+  std::vector<std::string> out;
+  size_t start = 0, nl;
+  while ((nl = s.find('\n', start)) != std::string::npos) {
+    out.push_back(s.substr(start, nl - start));
+    start = nl + 1;
+  }
+  out.push_back(s.substr(start));
+  return out;
+}
+
+static bool is_word(char c) { return std::isalnum((unsigned char)c) || c == '_'; }
+
+// One w / b / e step; callers fire the cursor event.
+static void word_forward(Buffer &buf) {
+  const auto &ln = buf.current_line();
+  int col = buf.cursor_col;
+  while (col < (int)ln.size() && is_word(ln[col]))
+    col++;
+  while (col < (int)ln.size() && std::isspace((unsigned char)ln[col]))
+    col++;
+  if (col >= (int)ln.size() && buf.cursor_row < (int)buf.lines.size() - 1) {
+    buf.cursor_row++;
+    buf.cursor_col = 0;
+  } else
+    buf.cursor_col = std::min(col, (int)ln.size());
+}
+
+static void word_backward(Buffer &buf) {
+  int col = buf.cursor_col;
+  const auto &ln = buf.current_line();
+  if (col == 0 && buf.cursor_row > 0) {
+    buf.cursor_row--;
+    buf.cursor_col = (int)buf.current_line().size();
+    return;
+  }
+  if (col > 0)
+    col--;
+  while (col > 0 && std::isspace((unsigned char)ln[col]))
+    col--;
+  while (col > 0 && is_word(ln[col - 1]))
+    col--;
+  buf.cursor_col = col;
+}
+
+static void word_end(Buffer &buf) {
+  const auto &ln = buf.current_line();
+  int col = buf.cursor_col;
+  if (col < (int)ln.size())
+    col++;
+  while (col < (int)ln.size() && std::isspace((unsigned char)ln[col]))
+    col++;
+  while (col + 1 < (int)ln.size() && is_word(ln[col + 1]))
+    col++;
+  buf.cursor_col = std::min(col, (int)ln.size());
+}
+
+// Runs step with each secondary cursor standing in as the primary, then
+// with the primary; cursors that meet merge.
+static void for_each_cursor(Buffer &buf, const std::function<void()> &step) {
+  const int row = buf.cursor_row, col = buf.cursor_col;
+  for (auto &c : buf.cursors) {
+    buf.cursor_row = c.row;
+    buf.cursor_col = c.col;
+    step();
+    c = {buf.cursor_row, buf.cursor_col};
+  }
+  buf.cursor_row = row;
+  buf.cursor_col = col;
+  step();
+  buf.normalize_cursors();
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  Syntax highlighting
 // ════════════════════════════════════════════════════════════════════════════
@@ -70,12 +176,7 @@ static std::string leading_ws(const std::string &s) {
 void VedApp::add_highlight_rule(const std::string &ext,
                                 const std::string &pattern,
                                 const std::string &token_type) {
-  try {
-    highlight_rules_[ext].push_back(
-        {token_type,
-         std::regex(pattern, std::regex::ECMAScript | std::regex::optimize)});
-  } catch (...) {
-  }
+  highlight_rules_[ext].pending.emplace_back(pattern, token_type);
 }
 
 void VedApp::clear_highlight_rules(const std::string &ext) {
@@ -110,16 +211,45 @@ void VedApp::init_default_highlight_rules() {
   add_highlight_rule(".wren", R"(\b\d+\.?\d*\b)", "number");
 }
 
+// Compiles any rules added since the last lookup; invalid patterns are
+// dropped. Null if the extension has no rules.
+const std::vector<HighlightRule> *
+VedApp::highlight_rules_for(const std::string &ext) {
+  auto it = highlight_rules_.find(ext);
+  if (it == highlight_rules_.end())
+    return nullptr;
+  auto &set = it->second;
+  if (!set.pending.empty()) {
+    TraceScope trace_scope("compile_rules");
+    for (auto &[pattern, type] : set.pending) {
+      try {
+        set.compiled.push_back(
+            {type, std::regex(pattern, std::regex::ECMAScript |
+                                           std::regex::optimize)});
+      } catch (...) {
+      }
+    }
+    set.pending.clear();
+  }
+  return &set.compiled;
+}
+
 // ── Per-line renderer ────────────────────────────────────────────────────────
 Element VedApp::render_line(const Buffer &buf, int row,
                             const std::string &ext) {
+  PerfScope perf_scope(PerfPhase::RenderLine);
   const std::string &line = buf.lines[row];
   const bool is_cur = (row == buf.cursor_row);
   const bool in_vis = (editor.mode == VISUAL) &&
                       (row >= std::min(visual_anchor_row_, buf.cursor_row)) &&
                       (row <= std::max(visual_anchor_row_, buf.cursor_row));
   const int len = (int)line.size();
-  const int disp = is_cur ? std::max(len, buf.cursor_col + 1) : len;
+  auto cur_beg = std::lower_bound(buf.cursors.begin(), buf.cursors.end(),
+                                  Cursor{row, 0});
+  auto cur_end = cur_beg;
+  int disp = is_cur ? std::max(len, buf.cursor_col + 1) : len;
+  for (; cur_end != buf.cursors.end() && cur_end->row == row; ++cur_end)
+    disp = std::max(disp, cur_end->col + 1);
 
   if (disp == 0)
     return text("") | color(Color::GrayLight);
@@ -131,9 +261,9 @@ Element VedApp::render_line(const Buffer &buf, int row,
   std::vector<CA> attrs(disp, {Color::GrayLight, false, false, false});
 
   // Syntax pass
-  auto it_rules = highlight_rules_.find(ext);
-  if (it_rules != highlight_rules_.end()) {
-    for (auto &rule : it_rules->second) {
+  if (auto *rules = highlight_rules_for(ext)) {
+    TraceScope trace_scope("highlight");
+    for (auto &rule : *rules) {
       try {
         auto beg =
             std::sregex_iterator(line.begin(), line.end(), rule.compiled);
@@ -148,22 +278,42 @@ Element VedApp::render_line(const Buffer &buf, int row,
     }
   }
 
-  // Visual selection pass
-  if (in_vis)
-    for (auto &a : attrs)
-      a.visual = true;
-
-  // Search match pass
-  if (!search_query_.empty()) {
-    try {
-      std::regex re(search_query_, std::regex::ECMAScript | std::regex::icase);
-      auto beg = std::sregex_iterator(line.begin(), line.end(), re);
-      for (auto it = beg; it != std::sregex_iterator(); ++it) {
-        int s = it->position(), e = s + it->length();
-        for (int c = s; c < e && c < len; ++c)
-          attrs[c].smatch = true;
-      }
-    } catch (...) {
+  // Visual selection pass: columns [vis_from, vis_to) of this row
+  if (in_vis) {
+    const Cursor anchor{visual_anchor_row_, visual_anchor_col_};
+    const Cursor cur{buf.cursor_row, buf.cursor_col};
+    const Cursor first = std::min(anchor, cur), last = std::max(anchor, cur);
+    int vis_from = 0, vis_to = disp;
+    if (visual_kind_ == VisualKind::Block) {
+      vis_from = std::min(anchor.col, cur.col);
+      vis_to = std::max(anchor.col, cur.col) + 1;
+    } else if (visual_kind_ == VisualKind::Char) {
+      if (row == first.row)
+        vis_from = first.col;
+      if (row == last.row)
+        vis_to = last.col + 1;
+    }
+    for (int c = vis_from; c < std::min(vis_to, disp); ++c)
+      attrs[c].visual = true;
+  }
+
+  // Search match pass: the searched buffer reuses its match list, other
+  // panes rerun the compiled query on the line.
+  if (search_valid_) {
+    auto mark = [&](int s, int e) {
+      for (int c = s; c < e && c < len; ++c)
+        attrs[c].smatch = true;
+    };
+    if (search_buf_.lock().get() == &buf) {
+      auto it = std::lower_bound(
+          search_matches_.begin(), search_matches_.end(), row,
+          [](const SearchMatch &m, int r) { return m.row < r; });
+      for (; it != search_matches_.end() && it->row == row; ++it)
+        mark(it->col, it->col + it->len);
+    } else {
+      auto beg = std::sregex_iterator(line.begin(), line.end(), search_re_);
+      for (auto it = beg; it != std::sregex_iterator(); ++it)
+        mark((int)it->position(), (int)(it->position() + it->length()));
     }
   }
 
@@ -172,6 +322,8 @@ Element VedApp::render_line(const Buffer &buf, int row,
     int cc = std::min(buf.cursor_col, disp - 1);
     attrs[cc].cursor = true;
   }
+  for (auto it = cur_beg; it != cur_end; ++it)
+    attrs[std::min(it->col, disp - 1)].cursor = true;
 
   // Build elements
   Elements elems;
@@ -236,28 +388,99 @@ Element VedApp::make_overlay_elem() {
   return vbox({filler(), hbox({filler(), box, filler()}), filler()});
 }
 
+// ── Perf overlay ─────────────────────────────────────────────────────────────
+Element VedApp::make_perf_elem() {
+  if (!perf_overlay_)
+    return text("");
+  Elements rows;
+  char line[96];
+  std::snprintf(line, sizeof(line), " %-11s %8s %9s %9s %9s %9s ", "phase (us)",
+                "n", "p50", "p95", "p99", "max");
+  rows.push_back(text(line) | bold | color(Color::Cyan));
+  for (int i = 0; i < (int)PerfPhase::Count; ++i) {
+    auto p = (PerfPhase)i;
+    auto st = perf_stats().summary(p);
+    std::snprintf(line, sizeof(line), " %-11s %8llu %9.1f %9.1f %9.1f %9.1f ",
+                  perf_phase_name(p), (unsigned long long)st.count, st.p50_us,
+                  st.p95_us, st.p99_us, st.max_us);
+    rows.push_back(text(line) | color(Color::White));
+  }
+  if (kAllocStats) {
+    rows.push_back(separator());
+    std::snprintf(line, sizeof(line), " %-11s %8s %9s %9s %9s %9s ", "allocs",
+                  "calls", "allocs", "frees", "bytes", "/call");
+    rows.push_back(text(line) | bold | color(Color::Cyan));
+    for (int i = 0; i <= (int)PerfPhase::Count; ++i) {
+      auto a = alloc_totals(i);
+      uint64_t calls =
+          i < (int)PerfPhase::Count ? perf_stats().summary((PerfPhase)i).count : 0;
+      const char *name =
+          i < (int)PerfPhase::Count ? perf_phase_name((PerfPhase)i) : "other";
+      std::snprintf(line, sizeof(line),
+                    " %-11s %8llu %9llu %9llu %9s %9.1f ", name,
+                    (unsigned long long)calls, (unsigned long long)a.allocs,
+                    (unsigned long long)a.frees, human_bytes(a.bytes).c_str(),
+                    calls ? (double)a.allocs / calls : 0.0);
+      rows.push_back(text(line) | color(Color::White));
+    }
+    auto last = perf_stats().keystroke_allocs_last();
+    auto mean = perf_stats().keystroke_allocs_mean();
+    std::snprintf(line, sizeof(line),
+                  " per key: last %llu allocs / %s, mean %llu allocs / %s ",
+                  (unsigned long long)last.allocs, human_bytes(last.bytes).c_str(),
+                  (unsigned long long)mean.allocs, human_bytes(mean.bytes).c_str());
+    rows.push_back(text(line) | color(Color::GrayLight));
+  }
+  auto box = vbox(rows) | border | bgcolor(Color::Black);
+  return vbox({hbox({filler(), box}), filler()});
+}
+
+// Called at the end of the root renderer. The posted task runs once FTXUI
+// has laid out and written the frame, closing the keystroke measurement.
+void VedApp::probe_flush() {
+  if (!perf_probe_armed_)
+    return;
+  perf_probe_armed_ = false;
+  auto rendered = std::chrono::steady_clock::now();
+  auto received = perf_event_time_;
+  auto allocs0 = perf_event_allocs_;
+  screen_.Post([rendered, received, allocs0] {
+    auto now = std::chrono::steady_clock::now();
+    perf_stats().record(PerfPhase::Flush, now - rendered);
+    perf_stats().record(PerfPhase::Keystroke, now - received);
+    if (kAllocStats) {
+      auto a = alloc_totals_all();
+      perf_stats().record_keystroke_allocs({a.allocs - allocs0.allocs,
+                                            a.frees - allocs0.frees,
+                                            a.bytes - allocs0.bytes});
+    }
+  });
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  Search
 // ════════════════════════════════════════════════════════════════════════════
 
 void VedApp::do_search(const std::string &query) {
+  TraceScope trace_scope("do_search");
   search_query_ = query;
   search_matches_.clear();
   search_match_idx_ = -1;
+  search_valid_ = false;
+  search_buf_.reset();
   if (query.empty() || !sm_.focused_leaf())
     return;
-  auto &lines = sm_.focused_leaf()->buffer->lines;
   try {
-    std::regex re(query, std::regex::ECMAScript | std::regex::icase);
-    for (int r = 0; r < (int)lines.size(); ++r) {
-      auto beg = std::sregex_iterator(lines[r].begin(), lines[r].end(), re);
-      for (auto it = beg; it != std::sregex_iterator(); ++it)
-        search_matches_.push_back({r, (int)it->position(), (int)it->length()});
-    }
+    search_re_ = std::regex(query, std::regex::ECMAScript | std::regex::icase);
   } catch (...) {
     editor.status_msg = "invalid regex";
     return;
   }
+  search_valid_ = true;
+  search_buf_ = sm_.focused_leaf()->buffer;
+  auto &lines = sm_.focused_leaf()->buffer->lines;
+  for (int r = 0; r < (int)lines.size(); ++r)
+    scan_search_line(lines[r], r, search_matches_);
   editor.status_msg =
       std::to_string(search_matches_.size()) + " match(es): " + query;
   if (!search_matches_.empty()) {
@@ -266,93 +489,518 @@ void VedApp::do_search(const std::string &query) {
   }
 }
 
+void VedApp::scan_search_line(const std::string &line, int row,
+                              std::vector<SearchMatch> &out) {
+  auto beg = std::sregex_iterator(line.begin(), line.end(), search_re_);
+  for (auto it = beg; it != std::sregex_iterator(); ++it)
+    out.push_back({row, (int)it->position(), (int)it->length()});
+}
+
+// Keeps the match list in step with edits to the searched buffer: only the
+// replaced lines are rescanned, later matches shift.
+void VedApp::update_search_matches(Buffer &b, const BufferChange &c) {
+  if (!search_valid_ || search_buf_.lock().get() != &b)
+    return;
+  const int old_end = c.start + c.removed;
+  const int delta = c.inserted - c.removed;
+  std::vector<SearchMatch> out;
+  out.reserve(search_matches_.size());
+  auto it = search_matches_.begin();
+  for (; it != search_matches_.end() && it->row < c.start; ++it)
+    out.push_back(*it);
+  int stop = std::min(c.start + c.inserted, (int)b.lines.size());
+  for (int r = c.start; r < stop; ++r)
+    scan_search_line(b.lines[r], r, out);
+  for (; it != search_matches_.end(); ++it)
+    if (it->row >= old_end)
+      out.push_back({it->row + delta, it->col, it->len});
+  search_matches_ = std::move(out);
+  if (search_matches_.empty())
+    search_match_idx_ = -1;
+  else
+    search_match_idx_ = std::clamp(search_match_idx_, 0,
+                                   (int)search_matches_.size() - 1);
+}
+
 void VedApp::jump_next_match(Buffer &buf, int dir) {
   if (search_matches_.empty())
     return;
+  const int n = (int)search_matches_.size();
   if (dir != 0)
-    search_match_idx_ =
-        (search_match_idx_ + dir + (int)search_matches_.size()) %
-        (int)search_matches_.size();
+    search_match_idx_ = ((search_match_idx_ + dir) % n + n) % n;
   auto &m = search_matches_[search_match_idx_];
+  while (buf.folds.is_hidden(m.row))
+    buf.folds.set_closed(buf.folds.visible_row(m.row), false);
   buf.cursor_row = m.row;
   buf.cursor_col = m.col;
   buf.clamp_cursor();
   buf.fire_cursor_move();
 }
 
+// Ctrl+N: a cursor on the next match after the primary, which moves there.
+// Without a search on this buffer, searches the word under the cursor first.
+void VedApp::add_cursor_at_next_match(Buffer &buf) {
+  if (!search_valid_ || search_buf_.lock().get() != &buf) {
+    const auto &ln = buf.current_line();
+    int s = std::min(buf.cursor_col, (int)ln.size()), e = s;
+    while (s > 0 && is_word(ln[s - 1]))
+      --s;
+    while (e < (int)ln.size() && is_word(ln[e]))
+      ++e;
+    if (s == e) {
+      editor.status_msg = "no word under cursor";
+      return;
+    }
+    const int row = buf.cursor_row, col = buf.cursor_col;
+    do_search("\\b" + ln.substr(s, e - s) + "\\b");
+    buf.cursor_row = row;
+    buf.cursor_col = col;
+  }
+  if (search_matches_.empty())
+    return;
+  auto before = [](const SearchMatch &m, const Cursor &c) {
+    return m.row != c.row ? m.row < c.row : m.col < c.col;
+  };
+  Cursor pc{buf.cursor_row, buf.cursor_col};
+  // A primary inside a match snaps to its start, so all cursors line up.
+  auto at = std::lower_bound(search_matches_.begin(), search_matches_.end(),
+                             Cursor{pc.row, pc.col + 1}, before);
+  if (at != search_matches_.begin()) {
+    auto &m = at[-1];
+    if (m.row == pc.row && pc.col < m.col + m.len)
+      pc.col = m.col;
+  }
+  const int n = (int)search_matches_.size();
+  int idx = (int)(std::lower_bound(search_matches_.begin(),
+                                   search_matches_.end(),
+                                   Cursor{pc.row, pc.col + 1}, before) -
+                  search_matches_.begin());
+  for (int tries = 0; tries < n; ++tries, ++idx) {
+    auto &m = search_matches_[idx % n];
+    Cursor c{m.row, m.col};
+    if (c == pc || std::binary_search(buf.cursors.begin(), buf.cursors.end(), c))
+      continue;
+    buf.cursors.push_back(pc);
+    search_match_idx_ = idx % n;
+    while (buf.folds.is_hidden(m.row))
+      buf.folds.set_closed(buf.folds.visible_row(m.row), false);
+    buf.cursor_row = m.row;
+    buf.cursor_col = m.col;
+    buf.normalize_cursors();
+    buf.fire_cursor_move();
+    editor.status_msg = std::to_string(buf.cursors.size() + 1) + " cursors";
+    return;
+  }
+  editor.status_msg = "no more matches";
+}
+
+// Insert-mode keys with secondary cursors: one pass over all of them, one
+// change event. Script-bound insert keys keep acting on the primary.
+bool VedApp::multi_cursor_edit(Buffer &buf, const Event &e) {
+  if (e.is_character() && insert_keys_.count(e.character()))
+    return false;
+  BufferChange c;
+  if (e == Event::Tab)
+    c = buf.mc_insert("    ");
+  else if (e.is_character())
+    c = buf.mc_insert(e.character());
+  else if (e == Event::Backspace)
+    c = buf.mc_backspace();
+  else if (e == Event::Return)
+    c = buf.mc_newline();
+  else if (e == Event::ArrowLeft || e == Event::ArrowRight ||
+           e == Event::ArrowUp || e == Event::ArrowDown) {
+    const bool left = e == Event::ArrowLeft, right = e == Event::ArrowRight;
+    const bool up = e == Event::ArrowUp;
+    for_each_cursor(buf, [&] {
+      if (left || right) {
+        int len = (int)buf.current_line().size();
+        buf.cursor_col = std::clamp(buf.cursor_col + (left ? -1 : 1), 0, len);
+      } else if (up ? buf.line_up() : buf.line_down()) {
+        buf.cursor_col =
+            std::min(buf.cursor_col, (int)buf.current_line().size());
+      }
+    });
+    buf.fire_cursor_move();
+    return true;
+  } else
+    return false;
+  buf.fire_change(c);
+  buf.fire_cursor_move();
+  return true;
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Visual mode
+// ════════════════════════════════════════════════════════════════════════════
+
+void VedApp::enter_visual(Buffer &buf, VisualKind kind) {
+  visual_anchor_row_ = buf.cursor_row;
+  visual_anchor_col_ = buf.cursor_col;
+  visual_kind_ = kind;
+  editor.set_mode(VISUAL);
+}
+
+// Each edit is one pass over the selection, one undo step and one change
+// event however many rows it spans.
+bool VedApp::visual_edit(Buffer &buf, const std::string &k) {
+  if (k != "d" && k != "y" && k != "I" && k != "A")
+    return false;
+  TraceScope trace_scope("visual_edit");
+  const Cursor anchor{visual_anchor_row_, visual_anchor_col_};
+  const Cursor cur{buf.cursor_row, buf.cursor_col};
+  const Cursor first = std::min(anchor, cur), last = std::max(anchor, cur);
+  const int lo = first.row, hi = last.row, rows = hi - lo + 1;
+  const int left = std::min(anchor.col, cur.col);
+  const int right = std::max(anchor.col, cur.col) + 1;
+  const bool block = visual_kind_ == VisualKind::Block;
+
+  // I / A: a cursor per selected line, at the line start / end, or at the
+  // block's left / right edge; typing then fills the column.
+  if (k == "I" || k == "A") {
+    buf.push_undo();
+    if (block && k == "A") // pad short rows so the column lines up
+      buf.fire_change(
+          buf.put_block(lo, right, std::vector<std::string>(rows)));
+    std::vector<Cursor> at;
+    at.reserve(rows);
+    for (int r = lo; r <= hi; ++r) {
+      int len = (int)buf.lines[r].size();
+      if (!block)
+        at.push_back({r, k == "I" ? 0 : len});
+      else if (k == "A")
+        at.push_back({r, right});
+      else if (len >= left) // block I skips rows that end before it
+        at.push_back({r, left});
+    }
+    if (at.empty()) {
+      editor.set_mode(NORMAL);
+      editor.status_msg = "block starts past the line ends";
+      return true;
+    }
+    buf.cursor_row = at.front().row;
+    buf.cursor_col = at.front().col;
+    buf.cursors.assign(at.begin() + 1, at.end());
+    buf.normalize_cursors();
+    buf.fire_cursor_move();
+    editor.set_mode(EDITING);
+    editor.status_msg = std::to_string(buf.cursors.size() + 1) + " cursors";
+    return true;
+  }
+
+  const bool del = k == "d";
+  std::string what;
+  switch (visual_kind_) {
+  case VisualKind::Line:
+    yank_reg_ = join_lines(buf.lines, lo, hi + 1);
+    if (del) {
+      buf.push_undo();
+      buf.erase_lines(lo, rows);
+      bool emptied = buf.lines.empty();
+      if (emptied)
+        buf.lines.push_back("");
+      buf.modified = true;
+      buf.fire_change({lo, rows, emptied ? 1 : 0});
+    }
+    buf.cursor_row = lo;
+    what = std::to_string(rows) + " lines";
+    break;
+  case VisualKind::Char: {
+    // Past the end of a line, the selection takes its line break.
+    Cursor to{last.row, last.col + 1};
+    if (to.col > (int)buf.lines[to.row].size() &&
+        to.row + 1 < (int)buf.lines.size())
+      to = {to.row + 1, 0};
+    yank_reg_ = buf.text_range(first, to);
+    if (del) {
+      buf.push_undo();
+      buf.fire_change(buf.erase_range(first, to));
+    }
+    buf.cursor_row = first.row;
+    buf.cursor_col = first.col;
+    what = std::to_string(yank_reg_.size()) + " chars";
+    break;
+  }
+  case VisualKind::Block: {
+    auto cols = buf.block_text(lo, hi, left, right);
+    yank_reg_ = join_lines(cols, 0, (int)cols.size());
+    if (del) {
+      buf.push_undo();
+      buf.fire_change(buf.erase_block(lo, hi, left, right));
+    }
+    buf.cursor_row = lo;
+    buf.cursor_col = left;
+    what = std::to_string(rows) + "x" + std::to_string(right - left) + " block";
+    break;
+  }
+  }
+  yank_kind_ = visual_kind_;
+  buf.clamp_cursor();
+  buf.fire_cursor_move();
+  editor.set_mode(NORMAL);
+  editor.status_msg = what + (del ? " deleted" : " yanked");
+  return true;
+}
+
+void VedApp::put_inline(Buffer &buf, int after, int n) {
+  const auto &ln = buf.current_line();
+  const int col = std::min(buf.cursor_col + (ln.empty() ? 0 : after),
+                           (int)ln.size());
+  buf.push_undo();
+  if (yank_kind_ == VisualKind::Char) {
+    std::string text;
+    text.reserve(yank_reg_.size() * n);
+    while (n-- > 0)
+      text += yank_reg_;
+    buf.fire_change(buf.insert_text(buf.cursor_row, col, split_lines(text)));
+    buf.cursor_col = std::max(0, buf.cursor_col - 1); // on the last char
+  } else {
+    const int row = buf.cursor_row;
+    buf.fire_change(buf.put_block(row, col, split_lines(yank_reg_), n));
+    buf.cursor_row = row;
+    buf.cursor_col = col;
+  }
+  buf.fire_cursor_move();
+}
+
 // ════════════════════════════════════════════════════════════════════════════
-//  Pending double-key sequences (dd / yy / gg)
+//  Normal-mode keymap
 // ════════════════════════════════════════════════════════════════════════════
 
-bool VedApp::handle_pending(const std::string &key, Buffer &buf, Editor &ed) {
-  using clock = std::chrono::steady_clock;
-  auto now = clock::now();
-
-  if (!pending_key_.empty()) {
-    bool expired = std::chrono::duration_cast<std::chrono::milliseconds>(
-                       now - pending_key_time_)
-                       .count() > PENDING_TIMEOUT_MS;
-    if (!expired) {
-      std::string combo = pending_key_ + key;
-      pending_key_.clear();
-      if (combo == "dd") {
-        buf.push_undo();
-        yank_reg_ = buf.lines[buf.cursor_row];
-        buf.lines.erase(buf.lines.begin() + buf.cursor_row);
-        if (buf.lines.empty())
-          buf.lines.push_back("");
-        buf.clamp_cursor();
-        buf.modified = true;
-        buf.fire_change();
-        buf.fire_cursor_move();
-        editor.status_msg = "1 line deleted";
-        return true;
+void VedApp::bind_builtin_key(const std::string &seq, KeyAction fn) {
+  builtin_keys_.emplace_back(seq, std::move(fn));
+  keymap_dirty_ = true;
+}
+
+void VedApp::bind_motion_key(const std::string &seq,
+                             void (*step)(Buffer &, int)) {
+  bind_builtin_key(seq, [step](Buffer &b, Editor &, int n) {
+    const int row = b.cursor_row, col = b.cursor_col;
+    if (b.cursors.empty())
+      step(b, n);
+    else
+      for_each_cursor(b, [&] { step(b, n); });
+    if (b.cursor_row != row || b.cursor_col != col || !b.cursors.empty())
+      b.fire_cursor_move();
+  });
+}
+
+// Plugin keys shadow built-ins. A key trigger stands in for its plugin's
+// binding until the first press loads the plugin.
+void VedApp::build_keymap() {
+  TraceScope trace_scope("build_keymap");
+  keymap_.clear();
+  for (auto &[seq, fn] : builtin_keys_)
+    keymap_.bind(seq, fn);
+  for (auto &t : key_triggers_) {
+    std::string key = t.first;
+    keymap_.bind(key, [this, key](Buffer &, Editor &, int count) {
+      fire_triggers(key_triggers_, key);
+      build_keymap();
+      if (auto *a = keymap_.find(key)) {
+        KeyAction fn = *a;
+        fn(active_buf(), editor, count);
       }
-      if (combo == "yy") {
-        yank_reg_ = buf.lines[buf.cursor_row];
-        editor.status_msg = "1 line yanked";
-        return true;
+    });
+  }
+  for (auto &[seq, h] : normal_keys_) {
+    keymap_.bind(seq, [h](Buffer &b, Editor &ed, int count) {
+      if (count <= 1) {
+        h(b, ed);
+        return;
       }
-      if (combo == "gg") {
-        buf.cursor_row = 0;
-        buf.cursor_col = 0;
-        buf.fire_cursor_move();
+      b.begin_txn(); // one undo step and one change event for all of them
+      for (int i = 0; i < count; ++i)
+        h(b, ed);
+      b.end_txn();
+    });
+  }
+  key_reader_.restart();
+  keymap_dirty_ = false;
+}
+
+bool VedApp::dispatch_normal_key(const std::string &key) {
+  if (key == "q" && !macro_reg_.empty() && !replaying_ &&
+      !key_reader_.pending()) {
+    stop_macro();
+    return true;
+  }
+  for (;;) {
+    if (keymap_dirty_)
+      build_keymap();
+    auto r = key_reader_.feed(keymap_, key);
+    if (r.action) {
+      auto *leaf = sm_.focused_leaf();
+      if (!leaf)
         return true;
-      }
-    } else {
-      pending_key_.clear();
+      auto buf = leaf->buffer; // held: the action may close it
+      r.action(*buf, editor, r.count);
     }
+    if (!r.again)
+      return r.consumed;
+  }
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Macros and '.' repeat
+// ════════════════════════════════════════════════════════════════════════════
+
+// Live events go to the macro being recorded, and to the '.' candidate: the
+// keys from NORMAL mode with nothing pending until that state comes back.
+// The candidate becomes the '.' sequence if it changed the buffer.
+void VedApp::track_repeat(const Event &e) {
+  if (!macro_reg_.empty())
+    macro_keys_.push_back(e);
+  if (!dot_active_) {
+    auto *leaf = sm_.focused_leaf();
+    if (editor.mode != NORMAL || key_reader_.pending() || ctrl_w_pending_ ||
+        !leaf)
+      return;
+    dot_active_ = true;
+    dot_cur_.clear();
+    dot_buf_ = leaf->buffer.get();
+    dot_version_ = dot_buf_->version;
+  }
+  dot_cur_.push_back(e);
+}
+
+void VedApp::track_repeat_done() {
+  if (!dot_active_ || editor.mode != NORMAL || key_reader_.pending())
+    return;
+  dot_active_ = false;
+  auto *leaf = sm_.focused_leaf();
+  if (!leaf || leaf->buffer.get() != dot_buf_ ||
+      dot_buf_->version == dot_version_)
+    return;
+  // Undo, redo and replays change the buffer but don't replace '.'.
+  for (auto &k : dot_cur_) {
+    const std::string in = k.input();
+    if (in.size() == 1 && in[0] >= '0' && in[0] <= '9')
+      continue; // count
+    if (in == "u" || in == "\x12" || in == "." || in == "@")
+      return;
+    break;
+  }
+  dot_keys_ = std::move(dot_cur_);
+  dot_cur_.clear();
+}
+
+void VedApp::stop_macro() {
+  if (!macro_keys_.empty())
+    macro_keys_.pop_back(); // the closing q
+  editor.status_msg = "recorded @" + macro_reg_ + " (" +
+                      std::to_string(macro_keys_.size()) + " keys)";
+  macros_[macro_reg_] = std::move(macro_keys_);
+  macro_keys_.clear();
+  macro_reg_.clear();
+}
+
+void VedApp::replay_keys(std::vector<Event> keys, int times) {
+  auto *leaf = sm_.focused_leaf();
+  if (keys.empty() || !leaf)
+    return;
+  if (replaying_ >= MAX_REPLAY_DEPTH) {
+    editor.status_msg = "replay nested too deep";
+    return;
   }
+  TraceScope trace_scope("replay_keys");
+  auto buf = leaf->buffer;
+  EditorMode mode = editor.mode;
+  ++replaying_;
+  buf->begin_txn();
+  for (int i = 0; i < times; ++i)
+    for (auto &e : keys)
+      dispatch_event(e);
+  buf->end_txn();
+  --replaying_;
+  // Mode hooks were held back; scripts see only the net change.
+  if (!replaying_ && editor.mode != mode)
+    for (auto &f : editor.on_mode_change)
+      f(mode, editor.mode);
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Bracketed paste
+// ════════════════════════════════════════════════════════════════════════════
 
-  if (key == "d" || key == "y" || key == "g") {
-    pending_key_ = key;
-    pending_key_time_ = now;
+// True once the end marker arrives; paste_buf_ then holds the payload.
+bool VedApp::collect_paste(const Event &e) {
+  if (!pasting_) { // the begin marker
+    pasting_ = true;
+    paste_buf_.clear();
+    return false;
+  }
+  if (e.input() == kPasteEnd) {
+    pasting_ = false;
     return true;
   }
+  paste_buf_ += e.input();
   return false;
 }
 
+// Inserts at the cursor as typed text would land, but in one edit: no
+// auto-indent or tab expansion, one undo step, one change event.
+void VedApp::paste_text(std::string text) {
+  std::string norm;
+  norm.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] != '\r')
+      norm += text[i];
+    else if (i + 1 >= text.size() || text[i + 1] != '\n')
+      norm += '\n';
+  }
+  auto parts = split_lines(norm);
+
+  if (editor.mode == COMMAND || editor.mode == SEARCH) {
+    (editor.mode == COMMAND ? editor.command_buf : editor.search_buf) +=
+        parts.front();
+    return;
+  }
+  auto *leaf = sm_.focused_leaf();
+  if (!leaf || sm_.current().type != ScreenType::Editor ||
+      editor.mode == VISUAL)
+    return;
+  TraceScope trace_scope("paste_text");
+  auto &buf = *leaf->buffer;
+  buf.push_undo();
+  buf.fire_change(
+      buf.insert_text(buf.cursor_row, buf.cursor_col, std::move(parts)));
+  buf.fire_cursor_move();
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  Split rendering
 // ════════════════════════════════════════════════════════════════════════════
 
 Element VedApp::render_pane(SplitNode &pane, int w, int h, bool is_focused) {
+  TraceScope trace_scope("render_pane");
   auto &buf = *pane.buffer;
+  auto &folds = buf.folds;
   int &scroll = pane.scroll_offset;
 
+  folds.poll_indent(buf.lines, buf.version);
+  buf.cursor_row = folds.visible_row(buf.cursor_row);
+
+  // Scroll in visible (unfolded) lines so closed folds count as one row.
+  scroll = folds.visible_row(std::min(scroll, (int)buf.lines.size() - 1));
   if (buf.cursor_row < scroll)
     scroll = buf.cursor_row;
-  if (buf.cursor_row >= scroll + h)
-    scroll = buf.cursor_row - h + 1;
+  int shown = 0;
+  for (int r = scroll; r < buf.cursor_row && shown < h; r = folds.next_visible(r))
+    ++shown;
+  if (shown >= h) {
+    scroll = buf.cursor_row;
+    for (int k = 0; k < h - 1 && scroll > 0; ++k)
+      scroll = folds.prev_visible(scroll);
+  }
 
-  int start = scroll;
-  int end = std::min(start + h, (int)buf.lines.size());
   int total_lines = (int)buf.lines.size();
   int gutter_w = std::max(3, (int)std::to_string(total_lines).size()) + 1;
   std::string ext = file_ext(buf.filepath.empty() ? buf.name : buf.filepath);
 
   Elements line_elems;
-  for (int i = start; i < end; ++i) {
+  for (int i = scroll; i < total_lines && (int)line_elems.size() < h;
+       i = folds.next_visible(i)) {
     bool is_cur = is_focused && (i == buf.cursor_row);
     std::string num_str = is_cur ? std::to_string(i + 1)
                                  : std::to_string(std::abs(i - buf.cursor_row));
@@ -365,7 +1013,15 @@ Element VedApp::render_pane(SplitNode &pane, int w, int h, bool is_focused) {
 
     // Only draw cursor on focused pane
 
-    line_elems.push_back(hbox(num, render_line(buf, i, ext)));
+    int fold_end = folds.closed_end_at(i);
+    if (fold_end >= 0) {
+      auto marker = text(" \u00b7\u00b7\u00b7 " + std::to_string(fold_end - i) +
+                         " lines") |
+                    color(Color::GrayDark);
+      line_elems.push_back(hbox(num, render_line(buf, i, ext), marker));
+    } else {
+      line_elems.push_back(hbox(num, render_line(buf, i, ext)));
+    }
   }
 
   // Fill remaining height with '~'
@@ -404,11 +1060,18 @@ Component VedApp::build_editor() {
            if (!focused)
              return text("");
            auto &buf = *focused->buffer;
-           auto [term_w, term_h] = Terminal::Size();
+           auto [term_w, term_h] =
+               headless_w_ ? Dimensions{headless_w_, headless_h_}
+                           : Terminal::Size();
            int content_h = term_h - 2; // status bar + cmd/search bar
 
-           Element editor_area =
-               render_split_tree(*sm_.current().split_root, term_w, content_h);
+           Element editor_area;
+           {
+             PerfScope perf_scope(PerfPhase::Render);
+             TraceScope trace_scope("render_split_tree");
+             editor_area = render_split_tree(*sm_.current().split_root,
+                                             term_w, content_h);
+           }
 
            // Status bar
            std::string mode_label;
@@ -417,7 +1080,10 @@ Component VedApp::build_editor() {
              mode_label = " INSERT ";
              break;
            case VISUAL:
-             mode_label = " VISUAL ";
+             mode_label = visual_kind_ == VisualKind::Line ? " VISUAL LINE "
+                          : visual_kind_ == VisualKind::Block
+                              ? " VISUAL BLOCK "
+                              : " VISUAL ";
              break;
            case COMMAND:
              mode_label = " COMMAND ";
@@ -446,10 +1112,17 @@ Component VedApp::build_editor() {
            status_elems.push_back(text(status_right) | color(Color::GrayDark));
            for (auto &hook : status_hooks_)
              status_elems.push_back(hook());
+           if (&buf != status_buf_) {
+             status_buf_ = &buf;
+             invalidate_status_segs(SEG_OPEN);
+           }
            for (auto &seg : wren_status_segs_) {
-             std::string s = scripting_ ? scripting_->call_str(seg.cb) : "";
-             if (!s.empty())
-               status_elems.push_back(text(s) | color(Color::GrayLight));
+             if (seg.dirty && scripting_) {
+               seg.text = scripting_->call_str(seg.cb);
+               seg.dirty = false;
+             }
+             if (!seg.text.empty())
+               status_elems.push_back(text(seg.text) | color(Color::GrayLight));
            }
            auto status_bar = hbox(status_elems);
 
@@ -490,9 +1163,12 @@ Component VedApp::build_editor() {
                overlay_text_.clear();
                return true;
              }
-             if (editor.mode == NORMAL) {
+             if (editor.mode == NORMAL && !buf.cursors.empty()) {
+               buf.clear_cursors();
+               key_reader_.reset();
+             } else if (editor.mode == NORMAL) {
                sm_.pop();
-               pending_key_.clear();
+               key_reader_.reset();
              } else {
                editor.set_mode(NORMAL);
                pending_key_.clear();
@@ -505,13 +1181,31 @@ Component VedApp::build_editor() {
            if (editor.mode == NORMAL) {
              // Ctrl+R = redo
              if (e.input() == "\x12") {
-               if (buf.redo()) {
+               int done = 0;
+               for (int n = std::max(1, key_reader_.take_count());
+                    n > 0 && buf.redo(); --n)
+                 ++done;
+               if (done) {
                  buf.fire_change();
                  buf.fire_cursor_move();
                }
                return true;
              }
 	   
+             // Ctrl+N = cursor at next match
+             if (e.input() == "\x0e") {
+               key_reader_.reset();
+               add_cursor_at_next_match(buf);
+               return true;
+             }
+
+             // Ctrl+V = blockwise visual
+             if (e.input() == "\x16") {
+               key_reader_.reset();
+               enter_visual(buf, VisualKind::Block);
+               return true;
+             }
+
              // Ctrl+W prefix for splits
              if (e.input() == "\x17") {
                ctrl_w_pending_ = true;
@@ -545,179 +1239,8 @@ Component VedApp::build_editor() {
                return true;
              }
 
-             if (e.is_character()) {
-               std::string k = e.character();
-
-               if (handle_pending(k, buf, editor))
-                 return true;
-
-               if (k == "u") {
-                 if (buf.undo()) {
-                   buf.fire_change();
-                   buf.fire_cursor_move();
-                 }
-                 return true;
-               }
-               if (k == "x") {
-                 if (buf.cursor_col < (int)buf.current_line().size()) {
-                   buf.push_undo();
-                   yank_reg_ =
-                       std::string(1, buf.current_line()[buf.cursor_col]);
-                   buf.lines[buf.cursor_row].erase(buf.cursor_col, 1);
-                   buf.clamp_cursor();
-                   buf.modified = true;
-                   buf.fire_change();
-                   buf.fire_cursor_move();
-                 }
-                 return true;
-               }
-               if (k == "p") {
-                 if (!yank_reg_.empty()) {
-                   buf.push_undo();
-                   buf.lines.insert(buf.lines.begin() + buf.cursor_row + 1,
-                                    yank_reg_);
-                   buf.cursor_row++;
-                   buf.cursor_col = 0;
-                   buf.modified = true;
-                   buf.fire_change();
-                   buf.fire_cursor_move();
-                 }
-                 return true;
-               }
-               if (k == "P") {
-                 if (!yank_reg_.empty()) {
-                   buf.push_undo();
-                   buf.lines.insert(buf.lines.begin() + buf.cursor_row,
-                                    yank_reg_);
-                   buf.cursor_col = 0;
-                   buf.modified = true;
-                   buf.fire_change();
-                   buf.fire_cursor_move();
-                 }
-                 return true;
-               }
-               if (k == "G") {
-                 buf.cursor_row = (int)buf.lines.size() - 1;
-                 buf.cursor_col = 0;
-                 buf.fire_cursor_move();
-                 return true;
-               }
-               if (k == "n") {
-                 jump_next_match(buf, +1);
-                 return true;
-               }
-               if (k == "N") {
-                 jump_next_match(buf, -1);
-                 return true;
-               }
-               if (k == "/") {
-                 editor.search_buf.clear();
-                 editor.set_mode(SEARCH);
-                 return true;
-               }
-               if (k == "o") {
-                 buf.push_undo();
-                 std::string indent = leading_ws(buf.current_line());
-                 buf.lines.insert(buf.lines.begin() + buf.cursor_row + 1,
-                                  indent);
-                 buf.cursor_row++;
-                 buf.cursor_col = (int)indent.size();
-                 buf.modified = true;
-                 buf.fire_change();
-                 buf.fire_cursor_move();
-                 editor.set_mode(EDITING);
-                 return true;
-               }
-               if (k == "O") {
-                 buf.push_undo();
-                 std::string indent = leading_ws(buf.current_line());
-                 buf.lines.insert(buf.lines.begin() + buf.cursor_row, indent);
-                 buf.cursor_col = (int)indent.size();
-                 buf.modified = true;
-                 buf.fire_change();
-                 buf.fire_cursor_move();
-                 editor.set_mode(EDITING);
-                 return true;
-               }
-               if (k == "w") {
-                 const auto &ln = buf.current_line();
-                 int col = buf.cursor_col;
-                 while (col < (int)ln.size() &&
-                        (std::isalnum(ln[col]) || ln[col] == '_'))
-                   col++;
-                 while (col < (int)ln.size() && std::isspace(ln[col]))
-                   col++;
-                 if (col >= (int)ln.size() &&
-                     buf.cursor_row < (int)buf.lines.size() - 1) {
-                   buf.cursor_row++;
-                   buf.cursor_col = 0;
-                 } else
-                   buf.cursor_col = std::min(col, (int)ln.size());
-                 buf.fire_cursor_move();
-                 return true;
-               }
-               if (k == "b") {
-                 int col = buf.cursor_col;
-                 const auto &ln = buf.current_line();
-                 if (col == 0 && buf.cursor_row > 0) {
-                   buf.cursor_row--;
-                   buf.cursor_col = (int)buf.current_line().size();
-                 } else {
-                   if (col > 0)
-                     col--;
-                   while (col > 0 && std::isspace(ln[col]))
-                     col--;
-                   while (col > 0 &&
-                          (std::isalnum(ln[col - 1]) || ln[col - 1] == '_'))
-                     col--;
-                   buf.cursor_col = col;
-                 }
-                 buf.fire_cursor_move();
-                 return true;
-               }
-               if (k == "e") {
-                 const auto &ln = buf.current_line();
-                 int col = buf.cursor_col;
-                 if (col < (int)ln.size())
-                   col++;
-                 while (col < (int)ln.size() && std::isspace(ln[col]))
-                   col++;
-                 while (col + 1 < (int)ln.size() &&
-                        (std::isalnum(ln[col + 1]) || ln[col + 1] == '_'))
-                   col++;
-                 buf.cursor_col = std::min(col, (int)ln.size());
-                 buf.fire_cursor_move();
-                 return true;
-               }
-               if (k == "0") {
-                 buf.cursor_col = 0;
-                 buf.fire_cursor_move();
-                 return true;
-               }
-               if (k == "$") {
-                 buf.cursor_col = (int)buf.current_line().size();
-                 buf.fire_cursor_move();
-                 return true;
-               }
-               if (k == "i") {
-                 buf.push_undo();
-                 editor.set_mode(EDITING);
-                 return true;
-               }
-               if (k == "v") {
-                 visual_anchor_row_ = buf.cursor_row;
-                 visual_anchor_col_ = buf.cursor_col;
-                 editor.set_mode(VISUAL);
-                 return true;
-               }
-
-               auto it = normal_keys_.find(k);
-               if (it != normal_keys_.end()) {
-                 it->second(buf, editor);
-                 return true;
-               }
-               return false;
-             }
+             if (e.is_character())
+               return dispatch_normal_key(e.character());
 
              if (e == Event::ArrowLeft) {
                if (buf.cursor_col > 0)
@@ -732,8 +1255,7 @@ Component VedApp::build_editor() {
                return true;
              }
              if (e == Event::ArrowUp) {
-               if (buf.cursor_row > 0) {
-                 buf.cursor_row--;
+               if (buf.line_up()) {
                  buf.cursor_col =
                      std::min(buf.cursor_col, (int)buf.current_line().size());
                }
@@ -741,8 +1263,7 @@ Component VedApp::build_editor() {
                return true;
              }
              if (e == Event::ArrowDown) {
-               if (buf.cursor_row < (int)buf.lines.size() - 1) {
-                 buf.cursor_row++;
+               if (buf.line_down()) {
                  buf.cursor_col =
                      std::min(buf.cursor_col, (int)buf.current_line().size());
                }
@@ -751,8 +1272,7 @@ Component VedApp::build_editor() {
              }
 if (e == Event::Backspace) {
     if (buf.cursor_col > 0) buf.cursor_col--;
-    else if (buf.cursor_row > 0) {
-        buf.cursor_row--;
+    else if (buf.line_up()) {
         buf.cursor_col = (int)buf.current_line().size();
     }
     buf.fire_cursor_move();
@@ -763,59 +1283,49 @@ if (e == Event::Backspace) {
            // ── VISUAL mode
            // ──────────────────────────────────────────────────────────
            if (editor.mode == VISUAL) {
+             // v / V / Ctrl-V: switch kind, or leave if it is the current one
+             if (e.input() == "\x16" || e == Event::Character('V') ||
+                 e == Event::Character('v')) {
+               auto kind = e.input() == "\x16" ? VisualKind::Block
+                           : e.input() == "V"   ? VisualKind::Line
+                                                : VisualKind::Char;
+               if (kind == visual_kind_)
+                 editor.set_mode(NORMAL);
+               else
+                 visual_kind_ = kind;
+               return true;
+             }
              if (e.is_character()) {
                std::string k = e.character();
                int lo = std::min(visual_anchor_row_, buf.cursor_row);
                int hi = std::max(visual_anchor_row_, buf.cursor_row);
-               if (k == "d") {
-                 buf.push_undo();
-                 std::string yanked;
-                 for (int r = lo; r <= hi; ++r) {
-                   if (r > lo)
-                     yanked += '\n';
-                   yanked += buf.lines[r];
-                 }
-                 yank_reg_ = yanked;
-                 buf.lines.erase(buf.lines.begin() + lo,
-                                 buf.lines.begin() + hi + 1);
-                 if (buf.lines.empty())
-                   buf.lines.push_back("");
-                 buf.cursor_row = lo;
-                 buf.clamp_cursor();
-                 buf.modified = true;
-                 buf.fire_change();
-                 buf.fire_cursor_move();
-                 editor.set_mode(NORMAL);
-                 editor.status_msg =
-                     std::to_string(hi - lo + 1) + " lines deleted";
+               if (k == "z") {
+                 pending_key_ = "z";
+                 pending_key_time_ = std::chrono::steady_clock::now();
                  return true;
                }
-               if (k == "y") {
-                 std::string yanked;
-                 for (int r = lo; r <= hi; ++r) {
-                   if (r > lo)
-                     yanked += '\n';
-                   yanked += buf.lines[r];
-                 }
-                 yank_reg_ = yanked;
+               if (k == "f" && pending_key_ == "z") {
+                 pending_key_.clear();
+                 if (!add_fold(lo, hi))
+                   editor.status_msg = "cannot fold here";
+                 else
+                   close_fold(lo);
                  buf.cursor_row = lo;
                  buf.fire_cursor_move();
                  editor.set_mode(NORMAL);
-                 editor.status_msg =
-                     std::to_string(hi - lo + 1) + " lines yanked";
                  return true;
                }
+               if (visual_edit(buf, k))
+                 return true;
              }
              if (e == Event::ArrowUp || e == Event::Character("k")) {
-               if (buf.cursor_row > 0) {
-                 buf.cursor_row--;
+               if (buf.line_up()) {
                  buf.fire_cursor_move();
                }
                return true;
              }
              if (e == Event::ArrowDown || e == Event::Character("j")) {
-               if (buf.cursor_row < (int)buf.lines.size() - 1) {
-                 buf.cursor_row++;
+               if (buf.line_down()) {
                  buf.fire_cursor_move();
                }
                return true;
@@ -839,12 +1349,14 @@ if (e == Event::Backspace) {
            // ── EDITING mode
            // ──────────────────────────────────────────────────────────
            if (editor.mode == EDITING) {
+             if (!buf.cursors.empty() && multi_cursor_edit(buf, e))
+               return true;
              if (e == Event::Tab) {
                auto &ln = buf.lines[buf.cursor_row];
                ln.insert(buf.cursor_col, "    ");
                buf.cursor_col += 4;
                buf.modified = true;
-               buf.fire_change();
+               buf.fire_change(BufferChange::line(buf.cursor_row));
                buf.fire_cursor_move();
                return true;
              }
@@ -871,7 +1383,7 @@ if (e == Event::Backspace) {
                ln.insert(buf.cursor_col, k);
                buf.cursor_col++;
                buf.modified = true;
-               buf.fire_change();
+               buf.fire_change(BufferChange::line(buf.cursor_row));
                buf.fire_cursor_move();
                return true;
              }
@@ -888,8 +1400,7 @@ if (e == Event::Backspace) {
                return true;
              }
              if (e == Event::ArrowUp) {
-               if (buf.cursor_row > 0) {
-                 buf.cursor_row--;
+               if (buf.line_up()) {
                  buf.cursor_col =
                      std::min(buf.cursor_col, (int)buf.current_line().size());
                }
@@ -897,8 +1408,7 @@ if (e == Event::Backspace) {
                return true;
              }
              if (e == Event::ArrowDown) {
-               if (buf.cursor_row < (int)buf.lines.size() - 1) {
-                 buf.cursor_row++;
+               if (buf.line_down()) {
                  buf.cursor_col =
                      std::min(buf.cursor_col, (int)buf.current_line().size());
                }
@@ -911,16 +1421,16 @@ if (e == Event::Backspace) {
                  ln.erase(buf.cursor_col - 1, 1);
                  buf.cursor_col--;
                  buf.modified = true;
-                 buf.fire_change();
+                 buf.fire_change(BufferChange::line(buf.cursor_row));
                  buf.fire_cursor_move();
                } else if (buf.cursor_row > 0) {
                  std::string cur = ln;
-                 buf.lines.erase(buf.lines.begin() + buf.cursor_row);
+                 buf.erase_lines(buf.cursor_row, 1);
                  buf.cursor_row--;
                  buf.cursor_col = (int)buf.lines[buf.cursor_row].size();
                  buf.lines[buf.cursor_row] += cur;
                  buf.modified = true;
-                 buf.fire_change();
+                 buf.fire_change({buf.cursor_row, 2, 1});
                  buf.fire_cursor_move();
                }
                return true;
@@ -934,11 +1444,10 @@ if (e == Event::Backspace) {
                if (!before.empty() && before.back() == '{')
                  indent += "    ";
                buf.cursor_row++;
-               buf.lines.insert(buf.lines.begin() + buf.cursor_row,
-                                indent + rest);
+               buf.insert_line(buf.cursor_row, indent + rest);
                buf.cursor_col = (int)indent.size();
                buf.modified = true;
-               buf.fire_change();
+               buf.fire_change({buf.cursor_row - 1, 1, 2});
                buf.fire_cursor_move();
                return true;
              }
@@ -1012,6 +1521,66 @@ Component VedApp::build_bufferlist() {
          });
 }
 
+// ════════════════════════════════════════════════════════════════════════════
+//  build_memreport
+// ════════════════════════════════════════════════════════════════════════════
+
+Component VedApp::build_memreport() {
+  return Renderer([this]() -> Element {
+           char row[160];
+           auto fmt = [&](const std::string &name, const std::string &lines,
+                          const MemUsage &m) {
+             std::snprintf(row, sizeof(row),
+                           " %-24.24s %9s %11s %11s %11s %11s %11s ",
+                           name.c_str(), lines.c_str(), human_bytes(m.text).c_str(),
+                           human_bytes(m.undo).c_str(),
+                           human_bytes(m.redo).c_str(),
+                           human_bytes(m.caches).c_str(),
+                           human_bytes(m.total()).c_str());
+             return std::string(row);
+           };
+
+           Elements entries;
+           entries.push_back(text(" Memory ") | bold | color(Color::Cyan));
+           entries.push_back(separator());
+           std::snprintf(row, sizeof(row),
+                         " %-24s %9s %11s %11s %11s %11s %11s ", "buffer",
+                         "lines", "text", "undo", "redo", "caches", "total");
+           entries.push_back(text(row) | bold | color(Color::White));
+           for (auto &b : sm_.buffers()) {
+             auto m = b->memory_usage();
+             std::string hist = std::to_string(b->undo_stack_.size()) + "/" +
+                                std::to_string(b->redo_stack_.size());
+             entries.push_back(
+                 text(fmt(b->name, std::to_string(b->lines.size()), m) +
+                      " undo/redo " + hist) |
+                 color(Color::GrayLight));
+           }
+           entries.push_back(separator());
+           auto total = total_memory();
+           entries.push_back(text(fmt("all buffers + editor", "", total)) |
+                             bold | color(Color::White));
+           entries.push_back(
+               text(" wren heap " + human_bytes(ScriptingEngine::heap_bytes()) +
+                    " (peak " + human_bytes(ScriptingEngine::heap_peak()) + ")") |
+               color(Color::White));
+
+           auto list = vbox(entries) | flex | bgcolor(Color::Black);
+           auto status = hbox(text(" MEMORY ") | bgcolor(Color::Cyan) |
+                                  color(Color::Black) | bold,
+                              text("  q: close") | color(Color::GrayDark),
+                              filler());
+           return vbox(list, status);
+         }) |
+         CatchEvent([this](Event e) -> bool {
+           if (e == Event::Character('q') || e == Event::Escape) {
+             sm_.pop();
+             return true;
+           }
+           return false;
+         });
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  build_root
 // ════════════════════════════════════════════════════════════════════════════
@@ -1022,89 +1591,247 @@ Component VedApp::build_root() {
              screen_.Exit();
              return text("");
            }
-           if (sm_.current().type == ScreenType::BufferList)
-             return build_bufferlist()->Render();
-           return build_editor()->Render();
+           // More input is queued: keep the last frame; the drain redraws.
+           if (!input_queue_.empty() && last_doc_)
+             return last_doc_;
+           Element doc;
+           switch (sm_.current().type) {
+           case ScreenType::BufferList:
+             doc = build_bufferlist()->Render();
+             break;
+           case ScreenType::MemReport:
+             doc = build_memreport()->Render();
+             break;
+           default:
+             if (!editor_view_)
+               editor_view_ = build_editor();
+             doc = editor_view_->Render();
+             break;
+           }
+           probe_flush();
+           if (!scripts_loaded_ && !startup_posted_) {
+             // Runs once this first frame is on screen.
+             startup_posted_ = true;
+             startup_profile().mark("render");
+             screen_.Post([this] { finish_startup(); });
+           }
+           last_doc_ = doc;
+           return doc;
          }) |
          CatchEvent([this](Event e) -> bool {
-           if (!sm_.has_screens())
+           if (!sm_.has_screens() || e == Event::Custom)
              return false;
-
-           // COMMAND mode
-           if (editor.mode == COMMAND) {
-             if (e == Event::Escape) {
-               editor.set_mode(NORMAL);
-               editor.command_buf.clear();
-               return true;
-             }
-             if (e == Event::Backspace) {
-               if (!editor.command_buf.empty())
-                 editor.command_buf.pop_back();
-               return true;
-             }
-             if (e == Event::Return) {
-               Buffer *buf_ptr = sm_.focused_leaf()
-                                     ? sm_.focused_leaf()->buffer.get()
-                                     : nullptr;
-               std::string full = editor.command_buf;
-               std::string cmd = full, args;
-               auto sp = full.find(' ');
-               if (sp != std::string::npos) {
-                 cmd = full.substr(0, sp);
-                 args = full.substr(sp + 1);
-               }
-               auto it = commands_.find(cmd);
-               if (it != commands_.end())
-                 it->second(buf_ptr, editor, args);
-               else
-                 editor.status_msg = "unknown command: " + cmd;
-               editor.set_mode(NORMAL);
-               editor.command_buf.clear();
-               return true;
-             }
-             if (e.is_character()) {
-               editor.command_buf += e.character();
-               return true;
-             }
+           if (!scripts_loaded_) {
+             startup_keys_.push_back(e);
              return true;
            }
-
-           // SEARCH mode
-           if (editor.mode == SEARCH) {
-             if (e == Event::Escape) {
-               editor.set_mode(NORMAL);
-               editor.search_buf.clear();
-               return true;
-             }
-             if (e == Event::Backspace) {
-               if (!editor.search_buf.empty())
-                 editor.search_buf.pop_back();
-               return true;
-             }
-             if (e == Event::Return) {
-               do_search(editor.search_buf);
-               editor.set_mode(NORMAL);
-               editor.search_buf.clear();
-               return true;
-             }
-             if (e.is_character()) {
-               editor.search_buf += e.character();
-               return true;
-             }
+           if (perf_stats().enabled() && !perf_probe_armed_) {
+             perf_probe_armed_ = true;
+             perf_event_time_ = std::chrono::steady_clock::now();
+             if (kAllocStats)
+               perf_event_allocs_ = alloc_totals_all();
+           }
+           if (coalesce_input_) {
+             input_queue_.push_back(e);
+             schedule_drain();
              return true;
            }
+           return handle_input(e, 1);
+         });
+}
 
-           if (sm_.current().type == ScreenType::BufferList)
-             return build_bufferlist()->OnEvent(e);
+// ════════════════════════════════════════════════════════════════════════════
+//  Input queue
+// ════════════════════════════════════════════════════════════════════════════
 
-           if (editor.mode == NORMAL && e == Event::Character(':')) {
-             editor.set_mode(COMMAND);
-             editor.command_buf.clear();
-             return true;
-           }
+// Live input is queued and drained by a posted task, so a key-repeat burst
+// is handled in one go and drawn once: the root renderer keeps showing the
+// last frame while input is queued, and the drain asks for a single redraw.
+void VedApp::schedule_drain() {
+  if (drain_posted_)
+    return;
+  drain_posted_ = true;
+  screen_.Post([this] { drain_input(); });
+}
 
-           return build_editor()->OnEvent(e);
-         });
+// A run of one motion key ("jjjj") in NORMAL mode with nothing pending is
+// run as one counted motion: one cursor update.
+static bool coalescable(const Event &e) {
+  if (!e.is_character() || e.character().size() != 1)
+    return false;
+  return std::string("hjklwbe").find(e.character()[0]) != std::string::npos;
+}
+
+// Only a key bound on its own, starting no longer sequence ("jj", "gg"),
+// can run as one counted action.
+bool VedApp::is_leaf_key(const std::string &key) {
+  if (keymap_dirty_)
+    build_keymap();
+  int node = keymap_.next(Keymap::ROOT, key);
+  return node >= 0 && !keymap_.has_next(node) && keymap_.action(node);
+}
+
+void VedApp::drain_input() {
+  TraceScope trace_scope("drain_input");
+  drain_posted_ = false;
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(FRAME_MS);
+  while (!input_queue_.empty()) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      schedule_drain(); // draw what we have, then carry on
+      break;
+    }
+    Event e = std::move(input_queue_.front());
+    input_queue_.pop_front();
+    int times = 1;
+    if (coalescable(e) && editor.mode == NORMAL && !key_reader_.pending() &&
+        !ctrl_w_pending_ && !pasting_ && sm_.has_screens() &&
+        sm_.current().type == ScreenType::Editor && is_leaf_key(e.character()))
+      while (!input_queue_.empty() && input_queue_.front() == e) {
+        input_queue_.pop_front();
+        ++times;
+      }
+    handle_input(e, times);
+    if (!sm_.has_screens())
+      break;
+  }
+  screen_.PostEvent(Event::Custom);
+}
+
+// One event, or 'times' of the same coalescable key, from the root on.
+bool VedApp::handle_input(Event e, int times) {
+  PerfScope perf_scope(PerfPhase::Event);
+  TraceScope trace_scope("event");
+  for (int i = 0; i < times && recorder_.active(); ++i)
+    recorder_.note(e);
+
+  // Bracketed paste: the payload is collected, then handled as a
+  // single event (which macros and '.' also record as one).
+  if (pasting_ || e.input() == kPasteBegin) {
+    if (!collect_paste(e))
+      return true;
+    e = Event::Special(kPasteBegin + paste_buf_ + kPasteEnd);
+    paste_buf_.clear();
+  }
+
+  for (int i = 0; i < times; ++i)
+    track_repeat(e);
+  bool handled;
+  auto *leaf = sm_.focused_leaf();
+  if (times > 1 && leaf && is_leaf_key(e.character())) {
+    KeyAction fn = *keymap_.find(e.character()); // a copy: may rebind keys
+    auto buf = leaf->buffer;
+    fn(*buf, editor, times);
+    handled = true;
+  } else {
+    handled = false;
+    for (int i = 0; i < times; ++i)
+      handled = dispatch_event(e) || handled;
+  }
+  track_repeat_done();
+  return handled;
+}
+
+// Routes one event by screen and mode. Macro and '.' replay come straight
+// here, skipping the per-event perf, trace and recording work above.
+bool VedApp::dispatch_event(const Event &e) {
+  const std::string &in = e.input();
+  if (in.size() >= kPasteBegin.size() + kPasteEnd.size() &&
+      in.compare(0, kPasteBegin.size(), kPasteBegin) == 0) {
+    paste_text(in.substr(kPasteBegin.size(),
+                         in.size() - kPasteBegin.size() - kPasteEnd.size()));
+    return true;
+  }
+
+  // COMMAND mode
+  if (editor.mode == COMMAND) {
+    if (e == Event::Escape) {
+      editor.set_mode(NORMAL);
+      editor.command_buf.clear();
+      return true;
+    }
+    if (e == Event::Backspace) {
+      if (!editor.command_buf.empty())
+        editor.command_buf.pop_back();
+      return true;
+    }
+    if (e == Event::Return) {
+      std::string full = std::move(editor.command_buf);
+      editor.command_buf.clear();
+      run_command(full);
+      editor.set_mode(NORMAL);
+      return true;
+    }
+    if (e.is_character()) {
+      editor.command_buf += e.character();
+      return true;
+    }
+    return true;
+  }
+
+  // SEARCH mode
+  if (editor.mode == SEARCH) {
+    if (e == Event::Escape) {
+      editor.set_mode(NORMAL);
+      editor.search_buf.clear();
+      return true;
+    }
+    if (e == Event::Backspace) {
+      if (!editor.search_buf.empty())
+        editor.search_buf.pop_back();
+      return true;
+    }
+    if (e == Event::Return) {
+      do_search(editor.search_buf);
+      editor.set_mode(NORMAL);
+      editor.search_buf.clear();
+      return true;
+    }
+    if (e.is_character()) {
+      editor.search_buf += e.character();
+      return true;
+    }
+    return true;
+  }
+
+  if (sm_.current().type == ScreenType::BufferList)
+    return build_bufferlist()->OnEvent(e);
+  if (sm_.current().type == ScreenType::MemReport)
+    return build_memreport()->OnEvent(e);
+
+  if (editor.mode == NORMAL && e == Event::Character(':')) {
+    editor.set_mode(COMMAND);
+    editor.command_buf.clear();
+    return true;
+  }
+
+  if (!editor_view_)
+    editor_view_ = build_editor();
+  return editor_view_->OnEvent(e);
+}
+
+// Runs one command line (without the ':'); false if no such command.
+bool VedApp::run_command(const std::string &full) {
+  Buffer *buf_ptr =
+      sm_.focused_leaf() ? sm_.focused_leaf()->buffer.get() : nullptr;
+  std::string cmd = full, args;
+  auto sp = full.find(' ');
+  if (!full.empty() && full[0] == '!') {
+    cmd = "!";
+    args = full.substr(1);
+  } else if (sp != std::string::npos) {
+    cmd = full.substr(0, sp);
+    args = full.substr(sp + 1);
+  }
+  auto it = commands_.find(cmd);
+  if (it == commands_.end() && fire_triggers(command_triggers_, cmd))
+    it = commands_.find(cmd);
+  if (it == commands_.end()) {
+    editor.status_msg = "unknown command: " + cmd;
+    return false;
+  }
+  it->second(buf_ptr, editor, args);
+  return true;
 }
 
 // ════════════════════════════════════════════════════════════════════════════
@@ -1115,6 +1842,9 @@ VedApp::VedApp() {
   sm_.on_new_buffer.push_back([this](Buffer &buf) { setup_buffer_hooks(buf); });
 
   editor.on_mode_change.push_back([this](EditorMode prev, EditorMode next) {
+    invalidate_status_segs(SEG_MODE);
+    if (replaying_)
+      return; // replay_keys reports the net change
     if (scripting_ && wren_on_mode_change_.valid())
       scripting_->call2(wren_on_mode_change_, mode_to_str(prev),
                         mode_to_str(next));
@@ -1129,23 +1859,74 @@ VedApp::VedApp() {
   root->buffer = buf;
   sm_.push({ScreenType::Editor, root, nullptr, "editor"});
   sm_.set_focused(root.get());
+  startup_profile().mark("init");
+}
 
+void VedApp::load_scripts() {
+  if (scripts_loaded_)
+    return;
+  scripts_loaded_ = true;
   scripting_ = std::make_unique<ScriptingEngine>(*this);
-  std::string cfg = std::string(getenv("HOME")) + "/.config/slate";
+  startup_profile().mark("vm init");
+  std::string cfg = config_dir();
   scripting_->load_file(cfg + "/init.wren");
+  startup_profile().mark("init.wren");
   scripting_->load_plugins_dir(cfg + "/plugins");
+  for (auto &b : sm_.buffers())
+    if (!b->filepath.empty())
+      fire_triggers(ext_triggers_, file_ext(b->filepath));
+  startup_profile().mark("plugins");
+
+  // Files from the command line were opened before any hook existed.
+  if (!active_buf().filepath.empty() && wren_on_open_.valid())
+    scripting_->call0(wren_on_open_);
+}
+
+// Posted by the first root render: load scripts, then feed through any keys
+// that arrived meanwhile, ahead of anything still queued in FTXUI.
+void VedApp::finish_startup() {
+  startup_profile().mark("flush");
+  startup_profile().milestone("first frame");
+  load_scripts();
+  auto keys = std::move(startup_keys_);
+  startup_keys_.clear();
+  for (auto &e : keys)
+    root_->OnEvent(e);
+  startup_profile().mark("buffered keys");
+  startup_profile().milestone("ready");
+  screen_.PostEvent(Event::Custom); // redraw with plugin status segments etc.
 }
 
 void VedApp::setup_buffer_hooks(Buffer &buf) {
-  buf.on_change.push_back([this](Buffer &) {
+  buf.on_change.push_back([this](Buffer &b, const BufferChange &c) {
+    update_search_matches(b, c);
+    queue_change(b, c);
+    schedule_indent_scan(b);
+    invalidate_status_segs(SEG_CHANGE);
     if (scripting_ && wren_on_change_.valid())
       scripting_->call0(wren_on_change_);
   });
+  buf.on_cursor_move.push_back(
+      [this](Buffer &) { invalidate_status_segs(SEG_CURSOR); });
   buf.on_save.push_back([this](Buffer &) {
+    invalidate_status_segs(SEG_SAVE);
     if (scripting_ && wren_on_save_.valid())
       scripting_->call0(wren_on_save_);
   });
-  buf.on_open.push_back([this](Buffer &) {
+  buf.on_close.push_back([this](Buffer &b) {
+    for (auto &sub : change_subs_)
+      sub.pending.erase(b.id);
+    auto it = indent_timers_.find(b.id);
+    if (it != indent_timers_.end()) {
+      timers_.cancel(it->second);
+      indent_timers_.erase(it);
+    }
+  });
+  buf.on_open.push_back([this](Buffer &b) {
+    if (!batch_)
+      b.folds.request_indent(b.lines, b.version);
+    fire_triggers(ext_triggers_, file_ext(b.filepath));
+    invalidate_status_segs(SEG_OPEN);
     if (scripting_ && wren_on_open_.valid())
       scripting_->call0(wren_on_open_);
   });
@@ -1156,32 +1937,219 @@ void VedApp::setup_buffer_hooks(Buffer &buf) {
 // ════════════════════════════════════════════════════════════════════════════
 
 void VedApp::init_keybinds() {
-  normal_keys_["h"] = [](Buffer &b, Editor &) {
-    if (b.cursor_col > 0) {
-      b.cursor_col--;
+  // ── Motions: a count repeats the step; the cursor event fires once
+  bind_motion_key("h", [](Buffer &b, int n) {
+    b.cursor_col = std::max(0, b.cursor_col - std::max(1, n));
+  });
+  bind_motion_key("l", [](Buffer &b, int n) {
+    b.cursor_col = std::min((int)b.current_line().size(), b.cursor_col + std::max(1, n));
+  });
+  bind_motion_key("k", [](Buffer &b, int n) {
+    int moved = 0;
+    for (n = std::max(1, n); n > 0 && b.line_up(); --n)
+      ++moved;
+    if (moved)
+      b.cursor_col = std::min(b.cursor_col, (int)b.current_line().size());
+  });
+  bind_motion_key("j", [](Buffer &b, int n) {
+    int moved = 0;
+    for (n = std::max(1, n); n > 0 && b.line_down(); --n)
+      ++moved;
+    if (moved)
+      b.cursor_col = std::min(b.cursor_col, (int)b.current_line().size());
+  });
+  bind_motion_key("w", [](Buffer &b, int n) {
+    for (n = std::max(1, n); n > 0; --n)
+      word_forward(b);
+  });
+  bind_motion_key("b", [](Buffer &b, int n) {
+    for (n = std::max(1, n); n > 0; --n)
+      word_backward(b);
+  });
+  bind_motion_key("e", [](Buffer &b, int n) {
+    for (n = std::max(1, n); n > 0; --n)
+      word_end(b);
+  });
+  bind_motion_key("0", [](Buffer &b, int) { b.cursor_col = 0; });
+  bind_motion_key("$", [](Buffer &b, int) {
+    b.cursor_col = (int)b.current_line().size();
+  });
+  // G: last line, or line n; gg: first line, or line n
+  auto goto_line = [this](const std::string &key, bool last) {
+    bind_builtin_key(key, [last](Buffer &b, Editor &, int n) {
+      int rows = (int)b.lines.size();
+      int row = n > 0 ? std::min(n, rows) - 1 : last ? rows - 1 : 0;
+      b.cursor_row = b.folds.visible_row(row);
+      b.cursor_col = 0;
       b.fire_cursor_move();
-    }
+    });
   };
-  normal_keys_["l"] = [](Buffer &b, Editor &) {
-    if (b.cursor_col < (int)b.current_line().size()) {
-      b.cursor_col++;
+  goto_line("G", true);
+  goto_line("gg", false);
+  bind_builtin_key("n", [this](Buffer &b, Editor &, int n) {
+    jump_next_match(b, std::max(1, n));
+  });
+  bind_builtin_key("N", [this](Buffer &b, Editor &, int n) {
+    jump_next_match(b, -std::max(1, n));
+  });
+
+  // ── Edits: a count widens the one edit (one undo step, one change event)
+  bind_builtin_key("u", [](Buffer &b, Editor &, int n) {
+    int done = 0;
+    for (n = std::max(1, n); n > 0 && b.undo(); --n)
+      ++done;
+    if (done) {
+      b.fire_change();
       b.fire_cursor_move();
     }
-  };
-  normal_keys_["k"] = [](Buffer &b, Editor &) {
-    if (b.cursor_row > 0) {
-      b.cursor_row--;
-      b.cursor_col = std::min(b.cursor_col, (int)b.current_line().size());
+  });
+  bind_builtin_key("x", [this](Buffer &b, Editor &, int n) {
+    if (!b.cursors.empty()) {
+      b.push_undo();
+      b.fire_change(b.mc_delete(std::max(1, n)));
       b.fire_cursor_move();
+      return;
     }
+    auto &ln = b.lines[b.cursor_row];
+    int len = std::min(std::max(1, n), (int)ln.size() - b.cursor_col);
+    if (len <= 0)
+      return;
+    b.push_undo();
+    yank_reg_ = ln.substr(b.cursor_col, len);
+    yank_kind_ = VisualKind::Char;
+    ln.erase(b.cursor_col, len);
+    b.clamp_cursor();
+    b.modified = true;
+    b.fire_change(BufferChange::line(b.cursor_row));
+    b.fire_cursor_move();
+  });
+  bind_builtin_key("dd", [this](Buffer &b, Editor &ed, int n) {
+    int row = b.cursor_row;
+    n = std::min(std::max(1, n), (int)b.lines.size() - row);
+    b.push_undo();
+    yank_reg_ = join_lines(b.lines, row, row + n);
+    yank_kind_ = VisualKind::Line;
+    b.erase_lines(row, n);
+    bool emptied = b.lines.empty();
+    if (emptied)
+      b.lines.push_back("");
+    b.clamp_cursor();
+    b.modified = true;
+    b.fire_change({row, n, emptied ? 1 : 0});
+    b.fire_cursor_move();
+    ed.status_msg = n == 1 ? "1 line deleted"
+                           : std::to_string(n) + " lines deleted";
+  });
+  bind_builtin_key("yy", [this](Buffer &b, Editor &ed, int n) {
+    int row = b.cursor_row;
+    n = std::min(std::max(1, n), (int)b.lines.size() - row);
+    yank_reg_ = join_lines(b.lines, row, row + n);
+    yank_kind_ = VisualKind::Line;
+    ed.status_msg = n == 1 ? "1 line yanked"
+                           : std::to_string(n) + " lines yanked";
+  });
+  // p / P: the register n times over, as one insert below / above
+  auto put = [this](const std::string &key, int below) {
+    bind_builtin_key(key, [this, below](Buffer &b, Editor &, int n) {
+      if (yank_reg_.empty())
+        return;
+      if (yank_kind_ != VisualKind::Line) {
+        put_inline(b, below, std::max(1, n));
+        return;
+      }
+      auto one = split_lines(yank_reg_);
+      std::vector<std::string> ls;
+      ls.reserve(one.size() * std::max(1, n));
+      for (n = std::max(1, n); n > 0; --n)
+        ls.insert(ls.end(), one.begin(), one.end());
+      int at = b.cursor_row + below, added = (int)ls.size();
+      b.push_undo();
+      b.insert_lines(at, std::move(ls));
+      b.cursor_row = at;
+      b.cursor_col = 0;
+      b.modified = true;
+      b.fire_change({at, 0, added});
+      b.fire_cursor_move();
+    });
   };
-  normal_keys_["j"] = [](Buffer &b, Editor &) {
-    if (b.cursor_row < (int)b.lines.size() - 1) {
-      b.cursor_row++;
-      b.cursor_col = std::min(b.cursor_col, (int)b.current_line().size());
+  put("p", 1);
+  put("P", 0);
+  // o / O: open a line below / above with the current indent
+  auto open_line = [this](const std::string &key, int below) {
+    bind_builtin_key(key, [below](Buffer &b, Editor &ed, int) {
+      b.push_undo();
+      std::string indent = leading_ws(b.current_line());
+      b.insert_line(b.cursor_row + below, indent);
+      b.cursor_row += below;
+      b.cursor_col = (int)indent.size();
+      b.modified = true;
+      b.fire_change({b.cursor_row, 0, 1});
       b.fire_cursor_move();
-    }
+      ed.set_mode(EDITING);
+    });
   };
+  open_line("o", 1);
+  open_line("O", 0);
+
+  // ── Modes
+  bind_builtin_key("i", [](Buffer &b, Editor &ed, int) {
+    b.push_undo();
+    ed.set_mode(EDITING);
+  });
+  bind_builtin_key("v", [this](Buffer &b, Editor &, int) {
+    enter_visual(b, VisualKind::Char);
+  });
+  bind_builtin_key("V", [this](Buffer &b, Editor &, int) {
+    enter_visual(b, VisualKind::Line);
+  });
+  bind_builtin_key("/", [](Buffer &, Editor &ed, int) {
+    ed.search_buf.clear();
+    ed.set_mode(SEARCH);
+  });
+
+  // ── Macros and repeat: a count replays that many times
+  for (char c = 'a'; c <= 'z'; ++c) {
+    std::string reg(1, c);
+    bind_builtin_key("q" + reg, [this, reg](Buffer &, Editor &ed, int) {
+      if (replaying_)
+        return;
+      macro_reg_ = reg;
+      macro_keys_.clear();
+      ed.status_msg = "recording @" + reg;
+    });
+    bind_builtin_key("@" + reg, [this, reg](Buffer &, Editor &, int n) {
+      last_macro_ = reg;
+      auto it = macros_.find(reg);
+      if (it != macros_.end())
+        replay_keys(it->second, std::max(1, n));
+    });
+  }
+  bind_builtin_key("@@", [this](Buffer &, Editor &, int n) {
+    auto it = macros_.find(last_macro_);
+    if (it != macros_.end())
+      replay_keys(it->second, std::max(1, n));
+  });
+  bind_builtin_key(".", [this](Buffer &, Editor &, int n) {
+    replay_keys(dot_keys_, std::max(1, n));
+  });
+
+  // ── Folds: za zo zc zd zR zM zE
+  for (char c : std::string("aocdRME")) {
+    bind_builtin_key(std::string("z") + c, [this, c](Buffer &b, Editor &, int) {
+      int row = b.cursor_row;
+      switch (c) {
+      case 'a': toggle_fold(row); break;
+      case 'o': open_fold(row); break;
+      case 'c': close_fold(row); break;
+      case 'd': delete_fold(row); break;
+      case 'R': set_all_folds(false); break;
+      case 'M': set_all_folds(true); break;
+      case 'E': b.folds.clear(); break;
+      }
+      b.cursor_row = b.folds.visible_row(b.cursor_row);
+      b.fire_cursor_move();
+    });
+  }
 }
 
 // ════════════════════════════════════════════════════════════════════════════
@@ -1264,6 +2232,207 @@ void VedApp::init_commands() {
     bufferlist_cursor_ = 0;
     sm_.push({ScreenType::BufferList, nullptr, nullptr, "bufferlist"});
   };
+  commands_["mem"] = [this](Buffer *, Editor &, const std::string &) {
+    sm_.push({ScreenType::MemReport, nullptr, nullptr, "memory"});
+  };
+  commands_["trace"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    std::string verb = a.substr(0, a.find(' '));
+    std::string path =
+        a.find(' ') == std::string::npos ? "" : a.substr(a.find(' ') + 1);
+    if (verb == "start") {
+      if (!path.empty())
+        trace_path_ = path;
+      trace_start();
+      ed.status_msg = "tracing";
+    } else if (verb == "stop") {
+      if (!path.empty())
+        trace_path_ = path;
+      ed.status_msg = trace_stop(trace_path_) ? "trace written to " + trace_path_
+                                              : "cannot write " + trace_path_;
+    } else {
+      ed.status_msg = "usage: trace start|stop [file]";
+    }
+  };
+  commands_["!"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    if (a.empty()) {
+      ed.status_msg = "usage: ! command";
+      return;
+    }
+    int id = spawn_job_to_buffer(a, "!" + a);
+    ed.status_msg = "[job " + std::to_string(id) + "] " + a;
+  };
+  commands_["plugins"] = [this](Buffer *, Editor &ed, const std::string &) {
+    if (!scripting_ || scripting_->plugins().empty()) {
+      ed.status_msg = "no plugins";
+      return;
+    }
+    std::string msg;
+    for (auto &p : scripting_->plugins())
+      msg += (msg.empty() ? "" : "  ") + p.name + (p.loaded ? "" : " (lazy)");
+    ed.status_msg = msg + "  | modules: " +
+                    std::to_string(ScriptingEngine::modules_loaded());
+  };
+  // :reload [plugin|init] — everything loaded when no name is given
+  commands_["reload"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    if (!scripting_)
+      return;
+    if (!a.empty()) {
+      ed.status_msg = scripting_->reload(a) ? "reloaded " + a
+                                            : "no plugin named " + a;
+      return;
+    }
+    scripting_->reload("init");
+    int n = 0;
+    for (auto &p : scripting_->plugins())
+      if (p.loaded)
+        n += scripting_->reload(p.name);
+    ed.status_msg = "reloaded init.wren and " + std::to_string(n) + " plugin(s)";
+  };
+  commands_["source"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    if (!scripting_ || a.empty()) {
+      ed.status_msg = "usage: :source <file.wren>";
+      return;
+    }
+    scripting_->source(a);
+  };
+  // :vm [gc] — Wren heap, handle and binding counts
+  commands_["vm"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    if (!scripting_)
+      return;
+    if (a == "gc") {
+      size_t before = ScriptingEngine::heap_bytes();
+      double ms = scripting_->collect_garbage();
+      char msg[128];
+      std::snprintf(msg, sizeof(msg), "gc: %.2f ms, freed %s", ms,
+                    human_bytes(before - std::min(before, ScriptingEngine::heap_bytes()))
+                        .c_str());
+      ed.status_msg = msg;
+      return;
+    }
+    auto st = scripting_->vm_stats();
+    ed.status_msg = "wren heap " + human_bytes(st.heap_bytes) + " (peak " +
+                    human_bytes(st.heap_peak) + ")  handles " +
+                    std::to_string(st.live_handles) + "  bindings " +
+                    std::to_string(wren_bindings_.size()) + "  allocs " +
+                    std::to_string(st.allocs) + "  frees " +
+                    std::to_string(st.frees) + "  gc runs " +
+                    std::to_string(st.gc_runs);
+  };
+  commands_["jobs"] = [this](Buffer *, Editor &ed, const std::string &) {
+    if (!jobs_ || jobs_->list().empty()) {
+      ed.status_msg = "no jobs";
+      return;
+    }
+    std::string msg;
+    for (auto &j : jobs_->list())
+      msg += (msg.empty() ? "" : "  ") + std::to_string(j.id) +
+             (j.running ? ": " : " (queued): ") + j.cmd;
+    ed.status_msg = msg;
+  };
+  commands_["jobkill"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    int id = std::atoi(a.c_str());
+    ed.status_msg = id > 0 && cancel_job(id) ? "job " + a + " cancelled"
+                                             : "no job " + a;
+  };
+  // :cursors [all|clear] — all: a cursor on every match of the search
+  commands_["cursors"] = [this](Buffer *buf, Editor &ed, const std::string &a) {
+    if (!buf)
+      return;
+    if (a == "clear") {
+      buf->clear_cursors();
+    } else if (a == "all") {
+      if (!search_valid_ || search_buf_.lock().get() != buf ||
+          search_matches_.empty()) {
+        ed.status_msg = "cursors all: no search matches in this buffer";
+        return;
+      }
+      // The primary takes the first match at or after it.
+      auto it = std::lower_bound(
+          search_matches_.begin(), search_matches_.end(), *buf,
+          [](const SearchMatch &m, const Buffer &b) {
+            return m.row != b.cursor_row ? m.row < b.cursor_row
+                                         : m.col < b.cursor_col;
+          });
+      if (it == search_matches_.end())
+        it = search_matches_.begin();
+      buf->cursors.clear();
+      buf->cursors.reserve(search_matches_.size());
+      for (auto &m : search_matches_)
+        if (&m != &*it)
+          buf->cursors.push_back({m.row, m.col});
+      search_match_idx_ = (int)(it - search_matches_.begin());
+      buf->cursor_row = it->row;
+      buf->cursor_col = it->col;
+      buf->normalize_cursors();
+      buf->fire_cursor_move();
+    } else if (!a.empty()) {
+      ed.status_msg = "usage: cursors [all|clear]";
+      return;
+    }
+    ed.status_msg = std::to_string(buf->cursors.size() + 1) + " cursors";
+  };
+  commands_["record"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    std::string verb = a.substr(0, a.find(' '));
+    std::string path =
+        a.find(' ') == std::string::npos ? "" : a.substr(a.find(' ') + 1);
+    if (!path.empty())
+      record_path_ = path;
+    if (verb == "start") {
+      recorder_.start();
+      ed.status_msg = "recording keys";
+    } else if (verb == "stop" && recorder_.active()) {
+      size_t n = recorder_.size();
+      ed.status_msg = recorder_.stop(record_path_)
+                          ? std::to_string(n) + " events written to " + record_path_
+                          : "cannot write " + record_path_;
+    } else {
+      ed.status_msg = "usage: record start|stop [file]";
+    }
+  };
+  // :profile [reset | budget <ms> | watchdog <ms>] — per-plugin callback costs
+  commands_["profile"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    auto &prof = callback_profiler();
+    if (a == "reset") {
+      prof.reset();
+      ed.status_msg = "callback profile reset";
+      return;
+    }
+    if (a.rfind("budget", 0) == 0) {
+      prof.set_budget_ms(a.size() > 7 ? std::atof(a.c_str() + 7) : 0);
+      ed.status_msg = prof.budget_ms() > 0
+                          ? "callback budget " + a.substr(7) + " ms"
+                          : "callback budget off";
+      return;
+    }
+    if (a.rfind("watchdog", 0) == 0) {
+      prof.set_watchdog_ms(a.size() > 9 ? std::atof(a.c_str() + 9) : 0);
+      ed.status_msg = prof.watchdog_ms() > 0
+                          ? "script watchdog " + a.substr(9) + " ms"
+                          : "script watchdog off";
+      return;
+    }
+    set_overlay(prof.report());
+  };
+  commands_["perf"] = [this](Buffer *, Editor &ed, const std::string &a) {
+    auto &stats = perf_stats();
+    if (a == "reset") {
+      stats.reset();
+      ed.status_msg = "perf stats reset";
+      return;
+    }
+    if (a.rfind("dump", 0) == 0) {
+      std::string path = a.size() > 5 ? a.substr(5) : "slate-perf.json";
+      ed.status_msg = stats.dump(path) ? "perf stats written to " + path
+                                       : "cannot write " + path;
+      return;
+    }
+    if (!perf_hook_added_) {
+      add_overlay_hook([this] { return make_perf_elem(); });
+      perf_hook_added_ = true;
+    }
+    perf_overlay_ = !perf_overlay_;
+    stats.set_enabled(perf_overlay_ || !perf_dump_path_.empty());
+  };
 }
 
 // ════════════════════════════════════════════════════════════════════════════
@@ -1284,66 +2453,133 @@ void VedApp::open_file(const std::string &path) {
 }
 
 int VedApp::line_count() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return 0;
-  return (int)sm_.focused_leaf()->buffer->lines.size();
+  return (int)script_buffer()->lines.size();
 }
 
 std::string VedApp::get_line(int n) {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return "";
-  auto &lines = sm_.focused_leaf()->buffer->lines;
+  auto &lines = script_buffer()->lines;
   if (n < 0 || n >= (int)lines.size())
     return "";
   return lines[n];
 }
 
 void VedApp::set_line(int n, const std::string &s) {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   n = std::clamp(n, 0, (int)buf.lines.size() - 1);
   buf.lines[n] = s;
   buf.modified = true;
-  buf.fire_change();
+  buf.fire_change(BufferChange::line(n));
 }
 
 void VedApp::insert_line(int n, const std::string &s) {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   n = std::clamp(n, 0, (int)buf.lines.size());
-  buf.lines.insert(buf.lines.begin() + n, s);
+  buf.insert_line(n, s);
   buf.modified = true;
-  buf.fire_change();
+  buf.fire_change({n, 0, 1});
 }
 
 void VedApp::delete_line(int n) {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   if (n < 0 || n >= (int)buf.lines.size())
     return;
-  buf.lines.erase(buf.lines.begin() + n);
-  if (buf.lines.empty())
+  buf.erase_lines(n, 1);
+  bool emptied = buf.lines.empty();
+  if (emptied)
+    buf.lines.push_back("");
+  buf.clamp_cursor();
+  buf.modified = true;
+  buf.fire_change({n, 1, emptied ? 1 : 0});
+  buf.fire_cursor_move();
+}
+
+std::vector<std::string> VedApp::get_lines(int start, int end) {
+  if (!script_buffer())
+    return {};
+  auto &lines = script_buffer()->lines;
+  start = std::clamp(start, 0, (int)lines.size());
+  end = std::clamp(end, start, (int)lines.size());
+  return {lines.begin() + start, lines.begin() + end};
+}
+
+void VedApp::set_lines(int start, std::vector<std::string> ls) {
+  if (!script_buffer() || ls.empty())
+    return;
+  auto &buf = *script_buffer();
+  start = std::clamp(start, 0, (int)buf.lines.size());
+  size_t overlap = std::min(ls.size(), buf.lines.size() - start);
+  std::move(ls.begin(), ls.begin() + overlap, buf.lines.begin() + start);
+  if (overlap < ls.size())
+    buf.insert_lines((int)buf.lines.size(),
+                     {std::make_move_iterator(ls.begin() + overlap),
+                      std::make_move_iterator(ls.end())});
+  buf.modified = true;
+  buf.fire_change({start, (int)overlap, (int)ls.size()});
+}
+
+void VedApp::replace_range(int start, int end, std::vector<std::string> ls) {
+  if (!script_buffer())
+    return;
+  auto &buf = *script_buffer();
+  start = std::clamp(start, 0, (int)buf.lines.size());
+  end = std::clamp(end, start, (int)buf.lines.size());
+  int inserted = (int)ls.size();
+  if (end > start)
+    buf.erase_lines(start, end - start);
+  buf.insert_lines(start, std::move(ls));
+  if (buf.lines.empty()) {
     buf.lines.push_back("");
+    inserted = 1;
+  }
   buf.clamp_cursor();
   buf.modified = true;
-  buf.fire_change();
+  buf.fire_change({start, end - start, inserted});
   buf.fire_cursor_move();
 }
 
+void VedApp::begin_transaction() {
+  if (!script_buffer())
+    return;
+  auto buf = script_buffer();
+  buf->begin_txn();
+  txn_bufs_.push_back(buf);
+}
+
+// Ends on the buffer the matching begin saw, even if focus moved since.
+void VedApp::end_transaction() {
+  if (txn_bufs_.empty())
+    return;
+  auto buf = std::move(txn_bufs_.back());
+  txn_bufs_.pop_back();
+  buf->end_txn();
+}
+
+void VedApp::unwind_transactions(size_t keep) {
+  while (txn_bufs_.size() > keep)
+    end_transaction();
+}
+
 std::string VedApp::get_cursor() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return "0:0";
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   return std::to_string(buf.cursor_row) + ":" + std::to_string(buf.cursor_col);
 }
 
 void VedApp::set_cursor(int row, int col) {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   buf.cursor_row = row;
   buf.cursor_col = col;
   buf.clamp_cursor();
@@ -1368,21 +2604,21 @@ void VedApp::set_mode_str(const std::string &s) {
 void VedApp::set_search_query(const std::string &s) { do_search(s); }
 
 bool VedApp::is_modified() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return false;
-  return sm_.focused_leaf()->buffer->modified;
+  return script_buffer()->modified;
 }
 
 std::string VedApp::file_path() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return "";
-  return sm_.focused_leaf()->buffer->filepath;
+  return script_buffer()->filepath;
 }
 
 void VedApp::do_undo() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   if (buf.undo()) {
     buf.fire_change();
     buf.fire_cursor_move();
@@ -1390,9 +2626,9 @@ void VedApp::do_undo() {
 }
 
 void VedApp::do_redo() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  auto &buf = *sm_.focused_leaf()->buffer;
+  auto &buf = *script_buffer();
   if (buf.redo()) {
     buf.fire_change();
     buf.fire_cursor_move();
@@ -1400,12 +2636,13 @@ void VedApp::do_redo() {
 }
 
 void VedApp::do_push_undo() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  sm_.focused_leaf()->buffer->push_undo();
+  script_buffer()->push_undo();
 }
 
 std::string VedApp::exec_cmd(const std::string &cmd) {
+  TraceScope trace_scope("exec_cmd");
   FILE *pipe = popen(cmd.c_str(), "r");
   if (!pipe)
     return "";
@@ -1428,10 +2665,209 @@ std::string VedApp::exec_cmd(const std::string &cmd) {
   return result;
 }
 
+// ── Jobs ─────────────────────────────────────────────────────────────────────
+
+JobManager &VedApp::jobs() {
+  if (!jobs_)
+    jobs_ = std::make_unique<JobManager>(
+        [this](std::function<void()> fn) { screen_.Post(std::move(fn)); });
+  return *jobs_;
+}
+
+// ── Workers ──────────────────────────────────────────────────────────────────
+
+WorkerPool &VedApp::workers() {
+  if (!workers_)
+    workers_ = std::make_unique<WorkerPool>(
+        [this](std::function<void()> fn) { screen_.Post(std::move(fn)); },
+        WorkerHandlers{[this](int id, WorkerMsg msg) {
+                         auto it = worker_cbs_.find(id);
+                         if (it != worker_cbs_.end() && scripting_)
+                           scripting_->call_msg(it->second.cb, msg);
+                       },
+                       [this](int id, const std::string &err) {
+                         set_status("worker " + std::to_string(id) + ": " + err);
+                       }});
+  return *workers_;
+}
+
+int VedApp::spawn_worker(const std::string &path, WrenHandle *r,
+                         WrenHandle *m) {
+  std::string p = path;
+  if (!p.empty() && p[0] != '/')
+    p = config_dir() + "/" + p;
+  int id = workers().spawn(p, config_dir() + "/modules");
+  worker_cbs_[id] = {{r, m}, own_work([this, id] { stop_worker(id); })};
+  return id;
+}
+
+bool VedApp::post_to_worker(int id, WorkerMsg msg) {
+  return workers_ && workers_->send(id, std::move(msg));
+}
+
+// One copy on the UI thread; the worker builds its Wren list off-thread.
+bool VedApp::post_snapshot_to_worker(int id) {
+  if (!workers_ || !script_buffer())
+    return false;
+  WorkerMsg msg;
+  msg.kind = WorkerMsg::Lines;
+  msg.lines = std::make_shared<const std::vector<std::string>>(
+      script_buffer()->lines);
+  return workers_->send(id, std::move(msg));
+}
+
+bool VedApp::stop_worker(int id) {
+  if (!workers_ || !workers_->stop(id))
+    return false;
+  auto it = worker_cbs_.find(id);
+  if (it != worker_cbs_.end()) {
+    end_work(it->second.work);
+    if (scripting_)
+      scripting_->release(it->second.cb);
+    worker_cbs_.erase(it);
+  }
+  return true;
+}
+
+// Dropping the owner cancels the job and releases the callback, which the
+// job's late output then finds invalid.
+int VedApp::spawn_job(const std::string &cmd, WrenHandle *r, WrenHandle *m) {
+  auto cb = std::make_shared<WrenCallback>(WrenCallback{r, m});
+  auto job = std::make_shared<int>(0);
+  uint64_t work = own_work([this, cb, job] {
+    cancel_job(*job);
+    if (scripting_)
+      scripting_->release(*cb);
+  });
+  *job = jobs().spawn(
+      cmd, {[this, cb](JobStream s, const std::string &chunk) {
+              if (scripting_)
+                scripting_->call2(*cb, s == JobStream::Stdout ? "stdout" : "stderr",
+                                  chunk);
+            },
+            [this, cb, work](int status) {
+              if (!end_work(work) || !scripting_)
+                return;
+              scripting_->call2(*cb, "exit", (double)status);
+              scripting_->release(*cb);
+            }});
+  return *job;
+}
+
+int VedApp::spawn_job_to_buffer(const std::string &cmd,
+                                const std::string &name) {
+  auto buf = sm_.new_buffer(name);
+  if (sm_.focused_leaf())
+    sm_.focused_leaf()->buffer = buf;
+
+  // Whole lines are appended as they complete; the partial tail waits.
+  struct Sink {
+    std::weak_ptr<Buffer> buf;
+    std::string tail;
+    bool fresh = true; // still holding the new buffer's placeholder line
+  };
+  auto sink = std::make_shared<Sink>();
+  sink->buf = buf;
+  auto append = [sink](const std::string &text, bool flush) {
+    auto b = sink->buf.lock();
+    if (!b)
+      return;
+    sink->tail += text;
+    std::vector<std::string> ls;
+    size_t pos = 0, nl;
+    while ((nl = sink->tail.find('\n', pos)) != std::string::npos) {
+      ls.push_back(sink->tail.substr(pos, nl - pos));
+      pos = nl + 1;
+    }
+    sink->tail.erase(0, pos);
+    if (flush && !sink->tail.empty()) {
+      ls.push_back(std::move(sink->tail));
+      sink->tail.clear();
+    }
+    if (ls.empty())
+      return;
+    int at = (int)b->lines.size(), removed = 0, n = (int)ls.size();
+    // Replace the placeholder only while nothing has touched it.
+    if (sink->fresh && !b->modified && b->lines.size() == 1 &&
+        b->lines[0].empty()) {
+      b->erase_lines(0, 1);
+      at = 0;
+      removed = 1;
+    }
+    sink->fresh = false;
+    b->insert_lines(at, std::move(ls));
+    b->fire_change({at, removed, n});
+  };
+  return jobs().spawn(
+      cmd, {[append](JobStream, const std::string &chunk) { append(chunk, false); },
+            [this, append, name](int status) {
+              append("", true);
+              editor.status_msg = name + ": exit " + std::to_string(status);
+            }});
+}
+
+// A parked task belongs to whoever parked it; if they are dropped first, the
+// wake finds its work gone and the task is never resumed.
+void VedApp::wake_task(WrenHandle *task, int ms) {
+  uint64_t work = own_work([this, task] {
+    if (scripting_)
+      scripting_->release(task);
+  });
+  auto resume = [this, task, work] {
+    std::string owner;
+    if (end_work(work, &owner) && scripting_)
+      scripting_->resume_task(task, {}, owner);
+  };
+  if (ms <= 0)
+    screen_.Post(resume);
+  else
+    timers_.schedule(std::chrono::milliseconds(ms),
+                     [this, resume] { screen_.Post(resume); });
+}
+
+void VedApp::await_job(WrenHandle *task, const std::string &cmd) {
+  struct Output {
+    std::string out, err;
+  };
+  auto acc = std::make_shared<Output>();
+  auto job = std::make_shared<int>(0);
+  uint64_t work = own_work([this, task, job] {
+    cancel_job(*job);
+    if (scripting_)
+      scripting_->release(task);
+  });
+  *job = jobs().spawn(
+      cmd, {[acc](JobStream s, const std::string &chunk) {
+              (s == JobStream::Stdout ? acc->out : acc->err) += chunk;
+            },
+            [this, acc, task, work](int status) {
+              std::string owner;
+              if (!end_work(work, &owner) || !scripting_)
+                return;
+              scripting_->resume_task(task, [acc, status](WrenVM *vm, int slot) {
+                wrenEnsureSlots(vm, slot + 3);
+                wrenSetSlotNewMap(vm, slot);
+                wrenSetSlotString(vm, slot + 1, "code");
+                wrenSetSlotDouble(vm, slot + 2, (double)status);
+                wrenSetMapValue(vm, slot, slot + 1, slot + 2);
+                wrenSetSlotString(vm, slot + 1, "stdout");
+                wrenSetSlotBytes(vm, slot + 2, acc->out.data(), acc->out.size());
+                wrenSetMapValue(vm, slot, slot + 1, slot + 2);
+                wrenSetSlotString(vm, slot + 1, "stderr");
+                wrenSetSlotBytes(vm, slot + 2, acc->err.data(), acc->err.size());
+                wrenSetMapValue(vm, slot, slot + 1, slot + 2);
+              }, owner);
+            }});
+}
+
+bool VedApp::cancel_job(int id) { return jobs().cancel(id); }
+void VedApp::set_job_limit(int n) { jobs().set_max_running(n); }
+int VedApp::job_count() { return jobs_ ? (int)jobs_->list().size() : 0; }
+
 void VedApp::save_file() {
-  if (!sm_.focused_leaf())
+  if (!script_buffer())
     return;
-  sm_.focused_leaf()->buffer->save();
+  script_buffer()->save();
   editor.status_msg = "saved";
 }
 
@@ -1440,6 +2876,22 @@ void VedApp::close_buffer() {
     sm_.pop();
 }
 
+void VedApp::discard_buffer(const std::shared_ptr<Buffer> &buf) {
+  auto keep = buf; // 'buf' may refer into the list
+  keep->fire_close();
+  auto &bufs = sm_.buffers();
+  bufs.erase(std::remove(bufs.begin(), bufs.end(), keep), bufs.end());
+  if (!bufs.empty())
+    sm_.set_active_buffer(std::min(sm_.active_buffer_idx(), bufs.size() - 1));
+}
+
+const std::shared_ptr<Buffer> &VedApp::script_buffer() {
+  static const std::shared_ptr<Buffer> none;
+  if (script_buf_)
+    return script_buf_;
+  return sm_.focused_leaf() ? sm_.focused_leaf()->buffer : none;
+}
+
 void VedApp::next_buffer() {
   auto &bufs = sm_.buffers();
   if (bufs.empty() || !sm_.focused_leaf())
@@ -1467,6 +2919,26 @@ void VedApp::new_buffer_named(const std::string &name) {
   sm_.set_focused(root.get());
 }
 
+MemUsage VedApp::buffer_memory() {
+  if (!script_buffer())
+    return {};
+  return script_buffer()->memory_usage();
+}
+
+MemUsage VedApp::total_memory() {
+  MemUsage t;
+  for (auto &b : sm_.buffers()) {
+    auto m = b->memory_usage();
+    t.text += m.text;
+    t.undo += m.undo;
+    t.redo += m.redo;
+    t.caches += m.caches;
+  }
+  t.caches += yank_reg_.capacity() + search_query_.capacity() +
+              search_matches_.capacity() * sizeof(SearchMatch);
+  return t;
+}
+
 std::string VedApp::current_buffer_name() {
   if (!sm_.focused_leaf())
     return "";
@@ -1483,6 +2955,99 @@ void VedApp::set_overlay(const std::string &text) {
   overlay_active_ = !text.empty();
 }
 
+void VedApp::set_perf_dump(const std::string &path) {
+  perf_dump_path_ = path;
+  perf_stats().set_enabled(true);
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Folding (keys + Wren API)
+// ════════════════════════════════════════════════════════════════════════════
+
+// Fold edits act on the focused buffer's installed folds, which shift() keeps
+// in line with edits; a finished rescan is picked up first but never waited
+// for. Batch runs have no background scans, so they scan in place.
+static FoldTree *synced_folds(SplitNode *leaf, bool batch) {
+  if (!leaf)
+    return nullptr;
+  auto &buf = *leaf->buffer;
+  if (batch)
+    buf.folds.sync_indent(buf.lines, buf.version);
+  else
+    buf.folds.poll_indent(buf.lines, buf.version);
+  return &buf.folds;
+}
+
+// Each edit pushes the buffer's rescan back; the scan itself runs off the UI
+// thread.
+void VedApp::schedule_indent_scan(const Buffer &b) {
+  if (batch_)
+    return;
+  uint64_t id = b.id;
+  auto it = indent_timers_.find(id);
+  if (it != indent_timers_.end())
+    timers_.cancel(it->second);
+  indent_timers_[id] = timers_.schedule(
+      std::chrono::milliseconds(INDENT_RESCAN_MS), [this, id] {
+        screen_.Post([this, id] {
+          indent_timers_.erase(id);
+          for (auto &buf : sm_.buffers())
+            if (buf->id == id)
+              buf->folds.request_indent(buf->lines, buf->version);
+        });
+      });
+}
+
+bool VedApp::add_fold(int start, int end) {
+  auto *folds = synced_folds(sm_.focused_leaf(), batch_);
+  if (!folds || end >= line_count())
+    return false;
+  return folds->add(start, end, FoldKind::Manual);
+}
+
+void VedApp::delete_fold(int row) {
+  if (auto *folds = synced_folds(sm_.focused_leaf(), batch_))
+    if (!folds->remove(row))
+      editor.status_msg = "no fold found";
+}
+
+void VedApp::open_fold(int row) {
+  if (auto *folds = synced_folds(sm_.focused_leaf(), batch_))
+    if (!folds->set_closed(row, false))
+      editor.status_msg = "no fold found";
+}
+
+void VedApp::close_fold(int row) {
+  if (auto *folds = synced_folds(sm_.focused_leaf(), batch_))
+    if (!folds->set_closed(row, true))
+      editor.status_msg = "no fold found";
+}
+
+void VedApp::toggle_fold(int row) {
+  if (auto *folds = synced_folds(sm_.focused_leaf(), batch_))
+    if (!folds->toggle(row))
+      editor.status_msg = "no fold found";
+}
+
+void VedApp::set_all_folds(bool closed) {
+  if (auto *folds = synced_folds(sm_.focused_leaf(), batch_))
+    folds->set_all_closed(closed);
+}
+
+std::string VedApp::fold_at(int row) {
+  auto *folds = synced_folds(sm_.focused_leaf(), batch_);
+  FoldRange f;
+  if (!folds || !folds->innermost(row, f))
+    return "";
+  return std::to_string(f.start) + ":" + std::to_string(f.end);
+}
+
+bool VedApp::is_line_hidden(int row) {
+  if (!sm_.focused_leaf())
+    return false;
+  return sm_.focused_leaf()->buffer->folds.is_hidden(row);
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  Wren bind helpers
 // ════════════════════════════════════════════════════════════════════════════
@@ -1491,44 +3056,353 @@ void VedApp::bind_command(const std::string &name, CommandHandler fn) {
   commands_[name] = fn;
 }
 
+void VedApp::add_command_trigger(const std::string &name,
+                                 std::function<void()> fn) {
+  command_triggers_[name].push_back(std::move(fn));
+}
+
+void VedApp::add_key_trigger(const std::string &key, std::function<void()> fn) {
+  key_triggers_[key].push_back(std::move(fn));
+  keymap_dirty_ = true;
+}
+
+void VedApp::add_ext_trigger(const std::string &ext, std::function<void()> fn) {
+  ext_triggers_[ext].push_back(std::move(fn));
+}
+
+// Triggers are one-shot; they're removed before running so a plugin that
+// opens a file of its own extension doesn't re-enter.
+bool VedApp::fire_triggers(Triggers &t, const std::string &key) {
+  auto it = t.find(key);
+  if (it == t.end())
+    return false;
+  auto fns = std::move(it->second);
+  t.erase(it);
+  for (auto &fn : fns)
+    fn();
+  return true;
+}
+
+std::string VedApp::config_dir() const {
+  const char *home = getenv("HOME");
+  return std::string(home ? home : ".") + "/.config/slate";
+}
+
+// ── Binding ownership ────────────────────────────────────────────────────────
+
+// A binding with the same kind and name as an earlier one replaces it: the old
+// handles are released and its undo carries over, so dropping the newer one
+// restores what was there before either.
+void VedApp::own_binding(const std::string &kind, const std::string &name,
+                         WrenCallback cb, std::function<void()> undo,
+                         bool replaces) {
+  if (replaces) {
+    for (auto it = wren_bindings_.begin(); it != wren_bindings_.end(); ++it) {
+      if (it->kind != kind || it->name != name)
+        continue;
+      undo = std::move(it->undo);
+      if (scripting_)
+        scripting_->release(it->cb);
+      wren_bindings_.erase(it);
+      break;
+    }
+  }
+  wren_bindings_.push_back(
+      {callback_profiler().owner(), kind, name, cb, std::move(undo)});
+}
+
+uint64_t VedApp::own_work(std::function<void()> stop) {
+  uint64_t id = next_work_++;
+  script_work_[id] = {callback_profiler().owner(), std::move(stop)};
+  return id;
+}
+
+// False if the work was already dropped with its owner.
+bool VedApp::end_work(uint64_t id, std::string *owner) {
+  auto it = script_work_.find(id);
+  if (it == script_work_.end())
+    return false;
+  if (owner)
+    *owner = std::move(it->second.owner);
+  script_work_.erase(it);
+  return true;
+}
+
+void VedApp::drop_bindings(const std::string &owner) {
+  std::vector<std::function<void()>> stops;
+  for (auto it = script_work_.begin(); it != script_work_.end();) {
+    if (it->second.owner == owner) {
+      stops.push_back(std::move(it->second.stop));
+      it = script_work_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto &stop : stops)
+    stop();
+
+  std::vector<WrenBinding> dropped;
+  for (auto it = wren_bindings_.begin(); it != wren_bindings_.end();) {
+    if (it->owner == owner) {
+      dropped.push_back(std::move(*it));
+      it = wren_bindings_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Newest first, so stacked bindings unwind in order.
+  for (auto it = dropped.rbegin(); it != dropped.rend(); ++it) {
+    if (it->undo)
+      it->undo();
+    if (scripting_)
+      scripting_->release(it->cb);
+  }
+}
+
+ScriptingEngine::VmStats VedApp::vm_stats() {
+  return scripting_ ? scripting_->vm_stats() : ScriptingEngine::VmStats{};
+}
+
 void VedApp::bind_wren_command(const std::string &name, WrenHandle *r,
                                WrenHandle *m) {
+  auto it = commands_.find(name);
+  CommandHandler prev = it != commands_.end() ? it->second : nullptr;
   commands_[name] = [this, r, m](Buffer *, Editor &, const std::string &args) {
     WrenCallback cb{r, m};
     scripting_->call(cb, args);
   };
+  own_binding("command", name, {r, m}, [this, name, prev] {
+    if (prev)
+      commands_[name] = prev;
+    else
+      commands_.erase(name);
+  });
 }
 
 void VedApp::bind_wren_key(const std::string &key, WrenHandle *r,
                            WrenHandle *m) {
+  auto it = normal_keys_.find(key);
+  KeyHandler prev = it != normal_keys_.end() ? it->second : nullptr;
   normal_keys_[key] = [this, r, m](Buffer &, Editor &) {
     WrenCallback cb{r, m};
     scripting_->call(cb, "");
   };
+  keymap_dirty_ = true;
+  own_binding("key", key, {r, m}, [this, key, prev] {
+    if (prev)
+      normal_keys_[key] = prev;
+    else
+      normal_keys_.erase(key);
+    keymap_dirty_ = true;
+  });
 }
 
 void VedApp::bind_wren_insert_key(const std::string &key, WrenHandle *r,
                                   WrenHandle *m) {
+  auto it = insert_keys_.find(key);
+  KeyHandler prev = it != insert_keys_.end() ? it->second : nullptr;
   insert_keys_[key] = [this, r, m](Buffer &, Editor &) {
     WrenCallback cb{r, m};
     scripting_->call(cb, "");
   };
+  own_binding("insert_key", key, {r, m}, [this, key, prev] {
+    if (prev)
+      insert_keys_[key] = prev;
+    else
+      insert_keys_.erase(key);
+  });
+}
+
+void VedApp::bind_wren_on_change_debounced(int delay_ms, WrenHandle *r,
+                                           WrenHandle *m) {
+  change_subs_.push_back({{r, m}, std::max(0, delay_ms), {}, {}});
+  own_binding("on_change_debounced", "", {r, m}, [this, r] {
+    change_subs_.erase(std::remove_if(change_subs_.begin(), change_subs_.end(),
+                                      [r](const ChangeSub &c) {
+                                        return c.cb.receiver == r;
+                                      }),
+                       change_subs_.end());
+  }, false);
+}
+
+// ── Debounced change delivery ────────────────────────────────────────────────
+// Every change is merged into each subscriber's pending ranges and pushes its
+// deadline out by the subscriber's delay; one timer tracks the earliest.
+
+void VedApp::queue_change(Buffer &b, const BufferChange &c) {
+  if (change_subs_.empty())
+    return;
+  auto now = std::chrono::steady_clock::now();
+  for (auto &sub : change_subs_) {
+    merge_change(sub.pending[b.id], c);
+    sub.due = now + std::chrono::milliseconds(sub.delay_ms);
+  }
+  schedule_change_flush();
+}
+
+void VedApp::schedule_change_flush() {
+  auto earliest = std::chrono::steady_clock::time_point::max();
+  for (auto &sub : change_subs_)
+    if (!sub.pending.empty())
+      earliest = std::min(earliest, sub.due);
+  if (change_timer_)
+    timers_.cancel(change_timer_);
+  change_timer_ = 0;
+  if (earliest == std::chrono::steady_clock::time_point::max())
+    return;
+  change_timer_ =
+      timers_.schedule(earliest - std::chrono::steady_clock::now(), [this] {
+        screen_.Post([this] { flush_changes(); });
+      });
+}
+
+// The callback gets the changed buffer as its script_buffer(), so
+// Slate.getLine and friends read the text the ranges describe.
+void VedApp::flush_changes() {
+  auto now = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < change_subs_.size(); ++i) {
+    if (change_subs_[i].pending.empty() || change_subs_[i].due > now)
+      continue;
+    auto pending = std::move(change_subs_[i].pending);
+    change_subs_[i].pending.clear();
+    WrenCallback cb = change_subs_[i].cb;
+    for (auto &[id, ranges] : pending) {
+      std::shared_ptr<Buffer> target;
+      for (auto &b : sm_.buffers())
+        if (b->id == id)
+          target = b;
+      if (!target || !scripting_)
+        continue;
+      auto prev = std::exchange(script_buf_, target);
+      scripting_->call_changes(cb, ranges);
+      script_buf_ = std::move(prev);
+    }
+  }
+  schedule_change_flush();
 }
 
 void VedApp::bind_wren_on_change(WrenHandle *r, WrenHandle *m) {
   wren_on_change_ = {r, m};
+  own_binding("on_change", "", {r, m}, [this] { wren_on_change_ = {}; });
 }
 void VedApp::bind_wren_on_save(WrenHandle *r, WrenHandle *m) {
   wren_on_save_ = {r, m};
+  own_binding("on_save", "", {r, m}, [this] { wren_on_save_ = {}; });
 }
 void VedApp::bind_wren_on_open(WrenHandle *r, WrenHandle *m) {
   wren_on_open_ = {r, m};
+  own_binding("on_open", "", {r, m}, [this] { wren_on_open_ = {}; });
 }
 void VedApp::bind_wren_on_mode_change(WrenHandle *r, WrenHandle *m) {
   wren_on_mode_change_ = {r, m};
+  own_binding("on_mode_change", "", {r, m},
+              [this] { wren_on_mode_change_ = {}; });
+}
+int VedApp::add_wren_status_seg(WrenHandle *r, WrenHandle *m, unsigned refresh,
+                                int every_ms) {
+  WrenStatusSeg seg;
+  seg.cb = {r, m};
+  seg.id = next_status_seg_++;
+  seg.refresh = refresh;
+  seg.every_ms = every_ms;
+  wren_status_segs_.push_back(seg);
+  own_binding("status", "", {r, m}, [this, id = seg.id] {
+    wren_status_segs_.erase(
+        std::remove_if(wren_status_segs_.begin(), wren_status_segs_.end(),
+                       [id](const WrenStatusSeg &s) { return s.id == id; }),
+        wren_status_segs_.end());
+  }, false);
+  if (every_ms > 0)
+    schedule_status_timer(seg.id, every_ms);
+  return seg.id;
+}
+
+void VedApp::refresh_status_seg(int id) {
+  for (auto &seg : wren_status_segs_)
+    if (seg.id == id)
+      seg.dirty = true;
+  screen_.PostEvent(Event::Custom);
 }
-void VedApp::add_wren_status_seg(WrenHandle *r, WrenHandle *m) {
-  wren_status_segs_.push_back({{r, m}});
+
+void VedApp::invalidate_status_segs(unsigned trigger) {
+  for (auto &seg : wren_status_segs_)
+    if (seg.refresh & trigger)
+      seg.dirty = true;
+}
+
+// Re-arms itself from the UI thread while the segment exists.
+void VedApp::schedule_status_timer(int id, int ms) {
+  timers_.schedule(std::chrono::milliseconds(ms), [this, id, ms] {
+    screen_.Post([this, id, ms] {
+      for (auto &seg : wren_status_segs_)
+        if (seg.id == id) {
+          refresh_status_seg(id);
+          schedule_status_timer(id, ms);
+        }
+    });
+  });
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Batch mode
+// ════════════════════════════════════════════════════════════════════════════
+
+// Opens path, runs the steps against it and saves it if it changed. The
+// buffer is dropped afterwards so a batch thread's memory doesn't grow with
+// the number of files. Hooks that post to the UI loop (debounced on_change,
+// jobs, timers) never run here.
+BatchResult VedApp::batch_file(const std::string &path,
+                               const std::vector<BatchStep> &steps,
+                               bool save) {
+  TraceScope trace_scope("batch_file");
+  BatchResult res;
+  batch_ = true;
+  load_scripts();
+  if (!std::ifstream(path)) {
+    res.error = "cannot open";
+    return res;
+  }
+  auto home = active_buf_ptr();
+  const auto before = sm_.buffers();
+  open_file(path);
+  auto buf = active_buf_ptr();
+  const uint64_t errors0 = ScriptingEngine::error_count();
+  for (auto &step : steps) {
+    focus_batch_buffer(buf);
+    editor.status_msg.clear();
+    bool ok = step.script ? scripting_->run_batch_script(step.text)
+                          : run_command(step.text);
+    if (!ok || ScriptingEngine::error_count() != errors0) {
+      res.error = (step.script ? step.text : ":" + step.text) + ": " +
+                  editor.status_msg;
+      break;
+    }
+  }
+  res.changed = buf->modified;
+  if (res.error.empty() && save && buf->modified && !buf->save())
+    res.error = "cannot write";
+
+  // Closed like any buffer, with any others the steps opened.
+  focus_batch_buffer(home);
+  for (auto &b : std::vector<std::shared_ptr<Buffer>>(sm_.buffers()))
+    if (std::find(before.begin(), before.end(), b) == before.end())
+      discard_buffer(b);
+  return res;
+}
+
+// Steps may close panes or screens; batch mode always has one to work in.
+void VedApp::focus_batch_buffer(std::shared_ptr<Buffer> buf) {
+  if (!sm_.focused_leaf()) {
+    auto root = std::make_shared<SplitNode>();
+    sm_.push({ScreenType::Editor, root, nullptr, "editor"});
+    sm_.set_focused(root.get());
+  }
+  sm_.focused_leaf()->buffer = std::move(buf);
+  editor.set_mode(NORMAL);
+}
+
+std::shared_ptr<Buffer> VedApp::active_buf_ptr() {
+  return sm_.focused_leaf() ? sm_.focused_leaf()->buffer : nullptr;
 }
 
 // ════════════════════════════════════════════════════════════════════════════
@@ -1536,6 +3410,40 @@ void VedApp::add_wren_status_seg(WrenHandle *r, WrenHandle *m) {
 // ════════════════════════════════════════════════════════════════════════════
 
 void VedApp::run() {
-  auto root = build_root();
-  screen_.Loop(root);
+  root_ = build_root();
+  coalesce_input_ = true;
+  std::fputs("\x1b[?2004h", stdout); // bracketed paste on
+  std::fflush(stdout);
+  screen_.Loop(root_);
+  std::fputs("\x1b[?2004l", stdout);
+  std::fflush(stdout);
+  if (!perf_dump_path_.empty())
+    perf_stats().dump(perf_dump_path_);
+}
+
+int VedApp::run_replay(const std::string &trace_path, const ReplayOptions &opts,
+                       const std::string &report_path) {
+  std::vector<KeyTraceEvent> events;
+  std::string err;
+  if (!load_key_trace(trace_path, events, err)) {
+    std::fprintf(stderr, "slate: %s\n", err.c_str());
+    return 1;
+  }
+  headless_w_ = opts.width;
+  headless_h_ = opts.height;
+  load_scripts();
+  auto report = replay_key_trace(build_root(), events, opts,
+                                 [this] { return !sm_.has_screens(); });
+  std::printf("%s\n", report.summary().c_str());
+  if (!report_path.empty()) {
+    std::ofstream f(report_path);
+    f << report.to_json();
+    if (!f) {
+      std::fprintf(stderr, "slate: cannot write %s\n", report_path.c_str());
+      return 1;
+    }
+  }
+  if (!perf_dump_path_.empty())
+    perf_stats().dump(perf_dump_path_);
+  return 0;
 }
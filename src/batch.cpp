@@ -0,0 +1,84 @@
+// batch.cpp — headless --batch runs over many files on a thread pool
+#include "batch.h"
+#include "app.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+bool parse_batch_args(int argc, char* argv[], int first, BatchOptions& out,
+                      std::string& err) {
+    for (int i = first; i < argc; ++i) {
+        const char* a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if (!std::strcmp(a, "-c") && has_arg) {
+            std::string cmd = argv[++i];
+            if (!cmd.empty() && cmd[0] == ':') cmd.erase(0, 1);
+            out.steps.push_back({false, cmd});
+        } else if (!std::strcmp(a, "-s") && has_arg) {
+            out.steps.push_back({true, argv[++i]});
+        } else if (!std::strcmp(a, "-j") && has_arg) {
+            out.jobs = std::atoi(argv[++i]);
+            if (out.jobs <= 0) {
+                err = "-j wants a positive number";
+                return false;
+            }
+        } else if (!std::strcmp(a, "--no-save")) {
+            out.save = false;
+        } else if (!std::strcmp(a, "--")) {
+            out.files.insert(out.files.end(), argv + i + 1, argv + argc);
+            break;
+        } else if (a[0] == '-' && a[1]) {
+            err = std::string("unknown or incomplete batch option ") + a;
+            return false;
+        } else {
+            out.files.push_back(a);
+        }
+    }
+    if (out.steps.empty()) err = "nothing to do: give -c ':cmd' or -s script";
+    else if (out.files.empty()) err = "no files";
+    return err.empty();
+}
+
+int run_batch(const BatchOptions& opts) {
+    TraceScope trace_scope("run_batch");
+    auto t0 = std::chrono::steady_clock::now();
+    int threads = opts.jobs > 0 ? opts.jobs
+                                : std::max(1, (int)std::thread::hardware_concurrency());
+    threads = std::min<int>(threads, (int)opts.files.size());
+
+    std::atomic<size_t> next{0};
+    std::mutex          out_mu;
+    size_t              changed = 0, failed = 0;
+
+    auto work = [&] {
+        VedApp app; // this thread's editor and VM
+        for (size_t i; (i = next++) < opts.files.size();) {
+            const auto& path = opts.files[i];
+            BatchResult r = app.batch_file(path, opts.steps, opts.save);
+            std::lock_guard<std::mutex> lk(out_mu);
+            if (!r.error.empty()) {
+                ++failed;
+                std::fprintf(stderr, "%s: error: %s\n", path.c_str(), r.error.c_str());
+            } else if (r.changed) {
+                ++changed;
+                std::fprintf(stderr, "%s: %s\n", path.c_str(),
+                             opts.save ? "saved" : "changed (not saved)");
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::fprintf(stderr, "slate: %zu files, %zu changed, %zu failed (%d threads, %.2f s)\n",
+                 opts.files.size(), changed, failed, threads, secs);
+    return failed ? 1 : 0;
+}
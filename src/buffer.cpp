@@ -1,27 +1,379 @@
 #include "buffer.h"
+#include "trace.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
 void Buffer::load(const std::string& path) {
+    TraceScope trace_scope("Buffer::load");
     filepath = path;
     name = path.substr(path.find_last_of("/\\") + 1);
     lines.clear();
+    folds.clear();
+    ++version;
     std::ifstream f(path);
-    if (!f.is_open()) { lines.push_back(""); fire_open(); return; }
+    if (!f.is_open()) { lines.push_back(""); synced_lines_ = 1; fire_open(); return; }
     std::string line;
     while (std::getline(f, line)) lines.push_back(line);
     if (lines.empty()) lines.push_back("");
+    synced_lines_ = (int)lines.size();
     modified = false;
     fire_open();
 }
 
-void Buffer::save() {
-    if (filepath.empty()) return;
+bool Buffer::save() {
+    TraceScope trace_scope("Buffer::save");
+    if (filepath.empty()) return false;
     std::ofstream f(filepath);
     for (size_t i = 0; i < lines.size(); ++i) {
         f << lines[i];
         if (i + 1 < lines.size()) f << '\n';
     }
+    f.flush();
+    if (!f) return false; // still modified
     modified = false;
     fire_save();
+    return true;
+}
+
+size_t lines_bytes(const std::vector<std::string>& lines) {
+    static const size_t sso = std::string().capacity();
+    size_t n = lines.capacity() * sizeof(std::string);
+    for (auto& l : lines)
+        if (l.capacity() > sso) n += l.capacity() + 1;
+    return n;
+}
+
+MemUsage Buffer::memory_usage() const {
+    MemUsage m;
+    m.text   = lines_bytes(lines) + name.capacity() + filepath.capacity();
+    m.undo   = undo_bytes_ + undo_stack_.capacity() * sizeof(HistoryEntry) +
+               txn_snapshot_.bytes;
+    m.redo   = redo_bytes_ + redo_stack_.capacity() * sizeof(HistoryEntry);
+    m.caches = folds.memory_bytes();
+    return m;
+}
+
+// ── Change deltas ────────────────────────────────────────────────────────────
+
+void merge_change(std::vector<BufferChange>& ranges, const BufferChange& c) {
+    const int c_end = c.start + c.removed; // current text
+    const int delta = c.inserted - c.removed;
+    int a = c.start, b = c_end, absorbed = 0;
+    bool placed = false;
+    std::vector<BufferChange> out;
+    out.reserve(ranges.size() + 1);
+    auto place = [&] {
+        out.push_back({a, (b - a) - absorbed, (b - a) + delta});
+        placed = true;
+    };
+    for (auto& p : ranges) {
+        int p_end = p.start + p.inserted;
+        if (p_end < c.start) {
+            out.push_back(p);
+        } else if (p.start > c_end) {
+            if (!placed) place();
+            out.push_back({p.start + delta, p.removed, p.inserted});
+        } else {
+            a = std::min(a, p.start);
+            b = std::max(b, p_end);
+            absorbed += p.inserted - p.removed;
+        }
+    }
+    if (!placed) place();
+    ranges = std::move(out);
+}
+
+BufferChange cover(const std::vector<BufferChange>& ranges) {
+    if (ranges.empty()) return {};
+    int start = ranges.front().start;
+    int end   = ranges.back().start + ranges.back().inserted;
+    int delta = 0;
+    for (auto& r : ranges) delta += r.inserted - r.removed;
+    return {start, (end - start) - delta, end - start};
+}
+
+// ── Ranges and blocks ────────────────────────────────────────────────────────
+
+std::string Buffer::text_range(Cursor from, Cursor to) const {
+    std::string out;
+    for (int r = from.row; r <= to.row; ++r) {
+        const auto& ln = lines[r];
+        int a = r == from.row ? std::min(from.col, (int)ln.size()) : 0;
+        int b = r == to.row ? std::min(to.col, (int)ln.size()) : (int)ln.size();
+        if (r > from.row) out += '\n';
+        if (b > a) out.append(ln, a, b - a);
+    }
+    return out;
+}
+
+BufferChange Buffer::erase_range(Cursor from, Cursor to) {
+    TraceScope trace_scope("Buffer::erase_range");
+    auto& first = lines[from.row];
+    const auto& last = lines[to.row];
+    int a = std::min(from.col, (int)first.size());
+    int b = std::min(to.col, (int)last.size());
+    std::string joined = first.substr(0, a);
+    joined.append(last, b, std::string::npos);
+    first = std::move(joined);
+    int gone = to.row - from.row;
+    if (gone) erase_lines(from.row + 1, gone);
+    cursor_row = from.row;
+    cursor_col = a;
+    modified = true;
+    return {from.row, gone + 1, 1};
+}
+
+BufferChange Buffer::insert_text(int row, int col, std::vector<std::string> parts) {
+    TraceScope trace_scope("Buffer::insert_text");
+    auto& ln = lines[row];
+    col = std::min(col, (int)ln.size());
+    std::string tail = ln.substr(col);
+    ln.erase(col);
+    ln += parts.front();
+    const int added = (int)parts.size() - 1;
+    if (!added) {
+        cursor_col = (int)ln.size();
+        ln += tail;
+    } else {
+        cursor_col = (int)parts.back().size();
+        parts.back() += tail;
+        insert_lines(row + 1, std::vector<std::string>(
+                                  std::make_move_iterator(parts.begin() + 1),
+                                  std::make_move_iterator(parts.end())));
+    }
+    cursor_row = row + added;
+    modified = true;
+    return {row, 1, added + 1};
+}
+
+std::vector<std::string> Buffer::block_text(int lo, int hi, int left, int right) const {
+    std::vector<std::string> out;
+    out.reserve(hi - lo + 1);
+    for (int r = lo; r <= hi; ++r) {
+        const auto& ln = lines[r];
+        int a = std::min(left, (int)ln.size()), b = std::min(right, (int)ln.size());
+        out.push_back(ln.substr(a, b - a));
+    }
+    return out;
+}
+
+BufferChange Buffer::erase_block(int lo, int hi, int left, int right) {
+    TraceScope trace_scope("Buffer::erase_block");
+    for (int r = lo; r <= hi; ++r) {
+        auto& ln = lines[r];
+        if (left < (int)ln.size()) ln.erase(left, right - left);
+    }
+    modified = true;
+    return {lo, hi - lo + 1, hi - lo + 1};
+}
+
+BufferChange Buffer::put_block(int row, int col, const std::vector<std::string>& block,
+                               int count) {
+    TraceScope trace_scope("Buffer::put_block");
+    const int old_rows = (int)lines.size();
+    const int end = row + (int)block.size();
+    if (end > old_rows)
+        insert_lines(old_rows, std::vector<std::string>(end - old_rows));
+    size_t width = 0;
+    for (auto& r : block) width = std::max(width, r.size());
+    std::string run;
+    for (int i = 0; i < (int)block.size(); ++i) {
+        auto& ln = lines[row + i];
+        const bool tail = (int)ln.size() > col;
+        run.clear();
+        for (int c = 0; c < count; ++c) {
+            run += block[i];
+            if (c + 1 < count || tail) run.resize((c + 1) * width, ' ');
+        }
+        if ((int)ln.size() < col) ln.resize(col, ' ');
+        ln.insert(col, run);
+    }
+    modified = true;
+    int kept = std::min(end, old_rows) - row;
+    return {row, kept, end - row};
+}
+
+// ── Multiple cursors ─────────────────────────────────────────────────────────
+
+namespace {
+
+// All cursors in document order, primary included at index 'primary'.
+std::vector<Cursor> all_cursors(const Buffer& b, size_t& primary) {
+    std::vector<Cursor> all;
+    all.reserve(b.cursors.size() + 1);
+    Cursor pc{b.cursor_row, b.cursor_col};
+    auto it = std::lower_bound(b.cursors.begin(), b.cursors.end(), pc);
+    all.insert(all.end(), b.cursors.begin(), it);
+    primary = all.size();
+    all.push_back(pc);
+    all.insert(all.end(), it, b.cursors.end());
+    return all;
+}
+
+void place_cursors(Buffer& b, std::vector<Cursor> all, size_t primary) {
+    b.cursor_row = all[primary].row;
+    b.cursor_col = all[primary].col;
+    all.erase(all.begin() + primary);
+    b.cursors = std::move(all);
+    b.normalize_cursors();
+    b.cursors_placed_ = true;
+}
+
+// Rewrites each line holding cursors [i, j) with edit(line, cursors).
+template <class Edit>
+void for_each_cursor_line(Buffer& b, std::vector<Cursor>& all, Edit edit) {
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].row == all[i].row) ++j;
+        edit(b.lines[all[i].row], all.begin() + i, all.begin() + j);
+        i = j;
+    }
+}
+
+BufferChange span(const std::vector<Cursor>& all) {
+    int n = all.back().row - all.front().row + 1;
+    return {all.front().row, n, n};
+}
+
+} // namespace
+
+void Buffer::normalize_cursors() {
+    const int rows = (int)lines.size();
+    for (auto& c : cursors) {
+        c.row = std::clamp(c.row, 0, rows - 1);
+        c.col = std::clamp(c.col, 0, (int)lines[c.row].size());
+    }
+    std::sort(cursors.begin(), cursors.end());
+    cursors.erase(std::unique(cursors.begin(), cursors.end()), cursors.end());
+    Cursor pc{cursor_row, cursor_col};
+    auto it = std::lower_bound(cursors.begin(), cursors.end(), pc);
+    if (it != cursors.end() && *it == pc) cursors.erase(it);
+}
+
+void Buffer::adjust_cursors(const BufferChange& c) {
+    const int delta = c.inserted - c.removed;
+    for (auto& cur : cursors) {
+        if (cur.row >= c.start + c.removed)
+            cur.row += delta;
+        else if (cur.row >= c.start + c.inserted)
+            cur.row = std::max(c.start, c.start + c.inserted - 1);
+    }
+    normalize_cursors();
+}
+
+BufferChange Buffer::mc_insert(const std::string& s) {
+    TraceScope trace_scope("Buffer::mc_insert");
+    size_t primary;
+    auto all = all_cursors(*this, primary);
+    for_each_cursor_line(*this, all, [&](std::string& ln, auto first, auto last) {
+        std::string out;
+        out.reserve(ln.size() + (last - first) * s.size());
+        int from = 0, shift = 0;
+        for (auto c = first; c != last; ++c) {
+            int col = std::min(c->col, (int)ln.size());
+            out.append(ln, from, col - from);
+            out += s;
+            from = col;
+            shift += (int)s.size();
+            c->col = col + shift;
+        }
+        out.append(ln, from, std::string::npos);
+        ln = std::move(out);
+    });
+    modified = true;
+    auto change = span(all);
+    place_cursors(*this, std::move(all), primary);
+    return change;
+}
+
+BufferChange Buffer::mc_backspace() {
+    TraceScope trace_scope("Buffer::mc_backspace");
+    size_t primary;
+    auto all = all_cursors(*this, primary);
+    for_each_cursor_line(*this, all, [&](std::string& ln, auto first, auto last) {
+        std::string out;
+        out.reserve(ln.size());
+        int from = 0, removed = 0;
+        for (auto c = first; c != last; ++c) {
+            int col = std::min(c->col, (int)ln.size());
+            if (col > from) { // the char before it is still there
+                out.append(ln, from, col - 1 - from);
+                from = col;
+                ++removed;
+            }
+            c->col = col - removed;
+        }
+        out.append(ln, from, std::string::npos);
+        if (removed) {
+            ln = std::move(out);
+            modified = true;
+        }
+    });
+    auto change = span(all);
+    place_cursors(*this, std::move(all), primary);
+    return change;
+}
+
+BufferChange Buffer::mc_delete(int n) {
+    TraceScope trace_scope("Buffer::mc_delete");
+    size_t primary;
+    auto all = all_cursors(*this, primary);
+    for_each_cursor_line(*this, all, [&](std::string& ln, auto first, auto last) {
+        std::string out;
+        out.reserve(ln.size());
+        // Each cursor deletes [col, col + n); overlapping spans merge, so
+        // nothing outside every cursor's own span goes.
+        int from = 0;
+        for (auto c = first; c != last; ++c) {
+            int col = std::min(c->col, (int)ln.size());
+            int end = std::min(col + n, (int)ln.size());
+            if (col > from) out.append(ln, from, col - from);
+            c->col = (int)out.size();
+            from = std::max(from, end);
+        }
+        out.append(ln, from, std::string::npos);
+        if (out.size() != ln.size()) {
+            ln = std::move(out);
+            modified = true;
+        }
+    });
+    auto change = span(all);
+    place_cursors(*this, std::move(all), primary);
+    return change;
+}
+
+// Splits every cursor's line at the cursor, rebuilding the affected rows
+// once rather than inserting a line per cursor.
+BufferChange Buffer::mc_newline() {
+    TraceScope trace_scope("Buffer::mc_newline");
+    size_t primary;
+    auto all = all_cursors(*this, primary);
+    const int lo = all.front().row, hi = all.back().row;
+    std::vector<std::string> mid;
+    mid.reserve(hi - lo + 1 + all.size());
+    size_t i = 0;
+    for (int r = lo; r <= hi; ++r) {
+        std::string& ln = lines[r];
+        int from = 0;
+        for (; i < all.size() && all[i].row == r; ++i) {
+            int col = std::min(all[i].col, (int)ln.size());
+            mid.push_back(ln.substr(from, col - from));
+            from = col;
+            all[i] = {lo + (int)mid.size(), 0};
+        }
+        mid.push_back(from ? ln.substr(from) : std::move(ln));
+    }
+    // Folds shift per split, bottom-up so earlier rows are still original.
+    for (size_t k = all.size(); k-- > 0;) {
+        int row = all[k].row - (int)k - 1; // original row of this split
+        folds.shift(row + 1, 1);
+    }
+    const int inserted = (int)mid.size();
+    lines.erase(lines.begin() + lo, lines.begin() + hi + 1);
+    lines.insert(lines.begin() + lo, std::make_move_iterator(mid.begin()),
+                 std::make_move_iterator(mid.end()));
+    modified = true;
+    place_cursors(*this, std::move(all), primary);
+    return {lo, hi - lo + 1, inserted};
 }
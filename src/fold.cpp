@@ -0,0 +1,428 @@
+// fold.cpp — fold tree (treap with lazy line shifts) + indentation scanner
+#include "fold.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Indentation folds
+// ════════════════════════════════════════════════════════════════════════════
+
+static int indent_width(const std::string& s, bool& blank) {
+    int w = 0;
+    for (char c : s) {
+        if (c == ' ')       w += 1;
+        else if (c == '\t') w += 4;
+        else { blank = false; return w; }
+    }
+    blank = true;
+    return w;
+}
+
+std::vector<FoldRange> compute_indent_folds(const std::vector<std::string>& lines) {
+    TraceScope trace_scope("compute_indent_folds");
+    struct Open { int start, indent; };
+    std::vector<FoldRange> out;
+    std::vector<Open> stack;
+    int last = -1; // last non-blank line seen
+
+    auto close_to = [&](int indent) {
+        while (!stack.empty() && stack.back().indent >= indent) {
+            if (last > stack.back().start)
+                out.push_back({stack.back().start, last, FoldKind::Indent, false});
+            stack.pop_back();
+        }
+    };
+
+    for (int i = 0; i < (int)lines.size(); ++i) {
+        bool blank;
+        int w = indent_width(lines[i], blank);
+        if (blank) continue;
+        close_to(w);
+        stack.push_back({i, w});
+        last = i;
+    }
+    close_to(-1);
+    return out;
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Treap plumbing
+// ════════════════════════════════════════════════════════════════════════════
+
+int FoldTree::alloc(const FoldRange& r) {
+    seed_ ^= seed_ << 13; seed_ ^= seed_ >> 17; seed_ ^= seed_ << 5;
+    Node n;
+    n.r    = r;
+    n.prio = seed_;
+    int idx;
+    if (!free_.empty()) { idx = free_.back(); free_.pop_back(); pool_[idx] = n; }
+    else                { idx = (int)pool_.size(); pool_.push_back(n); }
+    pull(idx);
+    ++count_;
+    return idx;
+}
+
+void FoldTree::release(int n) {
+    free_.push_back(n);
+    --count_;
+}
+
+void FoldTree::apply(int n, int d) {
+    if (n < 0 || d == 0) return;
+    auto& x = pool_[n];
+    x.r.start += d;
+    x.r.end   += d;
+    x.max_end += d;
+    if (x.max_closed_end != NONE) x.max_closed_end += d;
+    x.lazy += d;
+}
+
+void FoldTree::push(int n) {
+    auto& x = pool_[n];
+    if (!x.lazy) return;
+    apply(x.left, x.lazy);
+    apply(x.right, x.lazy);
+    x.lazy = 0;
+}
+
+void FoldTree::pull(int n) {
+    auto& x = pool_[n];
+    x.max_end        = x.r.end;
+    x.max_closed_end = x.r.closed ? x.r.end : NONE;
+    for (int c : {x.left, x.right}) {
+        if (c < 0) continue;
+        x.max_end        = std::max(x.max_end, pool_[c].max_end);
+        x.max_closed_end = std::max(x.max_closed_end, pool_[c].max_closed_end);
+    }
+}
+
+void FoldTree::split(int t, int key, int& l, int& r) {
+    if (t < 0) { l = r = -1; return; }
+    push(t);
+    if (pool_[t].r.start < key) {
+        split(pool_[t].right, key, pool_[t].right, r);
+        l = t;
+    } else {
+        split(pool_[t].left, key, l, pool_[t].left);
+        r = t;
+    }
+    pull(t);
+}
+
+int FoldTree::merge(int l, int r) {
+    if (l < 0) return r;
+    if (r < 0) return l;
+    if (pool_[l].prio > pool_[r].prio) {
+        push(l);
+        pool_[l].right = merge(pool_[l].right, r);
+        pull(l);
+        return l;
+    }
+    push(r);
+    pool_[r].left = merge(l, pool_[r].left);
+    pull(r);
+    return r;
+}
+
+void FoldTree::free_subtree(int t) {
+    if (t < 0) return;
+    free_subtree(pool_[t].left);
+    free_subtree(pool_[t].right);
+    release(t);
+}
+
+template <class Fn> bool FoldTree::edit(int start, Fn fn) {
+    int l, m, r;
+    split(root_, start, l, m);
+    split(m, start + 1, m, r);
+    bool found = m >= 0;
+    if (found) {
+        fn(pool_[m].r);
+        pull(m);
+    }
+    root_ = merge(merge(l, m), r);
+    return found;
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Queries
+// ════════════════════════════════════════════════════════════════════════════
+
+FoldRange FoldTree::at(const Hit& h) const {
+    FoldRange r = pool_[h.n].r;
+    r.start += h.off;
+    r.end   += h.off;
+    return r;
+}
+
+FoldTree::Hit FoldTree::find(int key) const {
+    int t = root_, off = 0;
+    while (t >= 0) {
+        const auto& x = pool_[t];
+        int s = x.r.start + off;
+        if (s == key) return {t, off};
+        off += x.lazy;
+        t = key < s ? x.left : x.right;
+    }
+    return {};
+}
+
+// Rightmost fold with start <= row <= end: the innermost, since folds nest.
+FoldTree::Hit FoldTree::innermost_node(int t, int off, int row) const {
+    if (t < 0) return {};
+    const auto& x = pool_[t];
+    if (x.max_end + off < row) return {};
+    int child_off = off + x.lazy;
+    if (x.r.start + off > row) return innermost_node(x.left, child_off, row);
+    Hit h = innermost_node(x.right, child_off, row);
+    if (h.n >= 0) return h;
+    if (x.r.end + off >= row) return {t, off};
+    return innermost_node(x.left, child_off, row);
+}
+
+// Leftmost closed fold with start < row <= end: the one whose header is shown.
+FoldTree::Hit FoldTree::outermost_closed(int t, int off, int row) const {
+    if (t < 0) return {};
+    const auto& x = pool_[t];
+    if (x.max_closed_end == NONE || x.max_closed_end + off < row) return {};
+    int child_off = off + x.lazy;
+    if (x.r.start + off >= row) return outermost_closed(x.left, child_off, row);
+    Hit h = outermost_closed(x.left, child_off, row);
+    if (h.n >= 0) return h;
+    if (x.r.closed && x.r.end + off >= row) return {t, off};
+    return outermost_closed(x.right, child_off, row);
+}
+
+bool FoldTree::innermost(int row, FoldRange& out) const {
+    Hit h = innermost_node(root_, 0, row);
+    if (h.n < 0) return false;
+    out = at(h);
+    return true;
+}
+
+int FoldTree::visible_row(int row) const {
+    Hit h = outermost_closed(root_, 0, row);
+    return h.n < 0 ? row : at(h).start;
+}
+
+int FoldTree::closed_end_at(int row) const {
+    Hit h = find(row);
+    if (h.n < 0 || !pool_[h.n].r.closed) return -1;
+    return at(h).end;
+}
+
+int FoldTree::next_visible(int row) const {
+    int v = visible_row(row);
+    int e = closed_end_at(v);
+    return e >= 0 ? e + 1 : v + 1;
+}
+
+bool FoldTree::any_closed() const {
+    return root_ >= 0 && pool_[root_].max_closed_end != NONE;
+}
+
+void FoldTree::collect(int t, int off, std::vector<FoldRange>& out) const {
+    if (t < 0) return;
+    const auto& x = pool_[t];
+    collect(x.left, off + x.lazy, out);
+    out.push_back(at({t, off}));
+    collect(x.right, off + x.lazy, out);
+}
+
+std::vector<FoldRange> FoldTree::ranges() const {
+    std::vector<FoldRange> out;
+    out.reserve(count_);
+    collect(root_, 0, out);
+    return out;
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Mutation
+// ════════════════════════════════════════════════════════════════════════════
+
+bool FoldTree::add(int start, int end, FoldKind kind, bool closed) {
+    if (start < 0 || end <= start) return false;
+
+    // A fold already starting on this line is replaced, so take it out
+    // before checking for crossings.
+    int l, m, r;
+    split(root_, start, l, m);
+    split(m, start + 1, m, r);
+    root_ = merge(l, r);
+
+    // Folds around the start line must reach past the new end, and folds
+    // starting inside the new range must end within it.
+    FoldRange f;
+    bool crosses = innermost(start, f) && f.end < end;
+    if (!crosses) {
+        int a, in, b;
+        split(root_, start + 1, a, in);
+        split(in, end + 1, in, b);
+        crosses = in >= 0 && pool_[in].max_end > end;
+        root_ = merge(merge(a, in), b);
+    }
+    if (crosses) {
+        if (m >= 0) {
+            split(root_, start, l, r);
+            root_ = merge(merge(l, m), r);
+        }
+        return false;
+    }
+
+    if (m >= 0) free_subtree(m);
+    split(root_, start, l, r);
+    root_ = merge(merge(l, alloc({start, end, kind, closed})), r);
+    return true;
+}
+
+bool FoldTree::remove(int row) {
+    FoldRange f;
+    if (!innermost(row, f)) return false;
+    int l, m, r;
+    split(root_, f.start, l, m);
+    split(m, f.start + 1, m, r);
+    free_subtree(m);
+    root_ = merge(l, r);
+    return true;
+}
+
+void FoldTree::clear() {
+    pool_.clear();
+    free_.clear();
+    root_  = -1;
+    count_ = 0;
+}
+
+void FoldTree::clamp(int line_count) {
+    if (root_ < 0 || pool_[root_].max_end < line_count) return;
+    auto all = ranges();
+    clear();
+    for (auto& f : all) {
+        if (f.start >= line_count) break;
+        add(f.start, std::min(f.end, line_count - 1), f.kind, f.closed);
+    }
+}
+
+bool FoldTree::set_closed(int row, bool closed) {
+    FoldRange f;
+    if (!innermost(row, f)) return false;
+    return edit(f.start, [&](FoldRange& r) { r.closed = closed; });
+}
+
+bool FoldTree::toggle(int row) {
+    FoldRange f;
+    if (!innermost(row, f)) return false;
+    return edit(f.start, [](FoldRange& r) { r.closed = !r.closed; });
+}
+
+void FoldTree::mark_closed(int t, bool closed) {
+    if (t < 0) return;
+    pool_[t].r.closed = closed;
+    mark_closed(pool_[t].left, closed);
+    mark_closed(pool_[t].right, closed);
+    pull(t);
+}
+
+void FoldTree::set_all_closed(bool closed) { mark_closed(root_, closed); }
+
+// Adjust the end of every fold that straddles the edit point. Only folds that
+// enclose 'at' qualify, so this walks the enclosing chain, not the tree.
+void FoldTree::shift_ends(int t, int at, int delta, std::vector<int>& degenerate) {
+    if (t < 0 || pool_[t].max_end < at) return;
+    push(t);
+    auto& x = pool_[t].r;
+    if (x.end >= at) {
+        if (delta > 0)               x.end += delta;
+        else if (x.end >= at - delta) x.end += delta;
+        else                          x.end = at - 1;
+        if (x.end <= x.start) degenerate.push_back(x.start);
+    }
+    shift_ends(pool_[t].left, at, delta, degenerate);
+    shift_ends(pool_[t].right, at, delta, degenerate);
+    pull(t);
+}
+
+void FoldTree::shift(int at, int delta) {
+    if (root_ < 0 || delta == 0) return;
+    int l, r;
+    split(root_, at, l, r);
+    if (delta < 0) {
+        // Folds that start inside the erased lines go with them.
+        int m;
+        split(r, at - delta, m, r);
+        free_subtree(m);
+    }
+    apply(r, delta);
+    std::vector<int> degenerate;
+    shift_ends(l, at, delta, degenerate);
+    root_ = merge(l, r);
+    for (int s : degenerate) {
+        int a, m, b;
+        split(root_, s, a, m);
+        split(m, s + 1, m, b);
+        free_subtree(m);
+        root_ = merge(a, b);
+    }
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Background indentation scan
+// ════════════════════════════════════════════════════════════════════════════
+
+void FoldTree::request_indent(const std::vector<std::string>& lines,
+                              uint64_t version) {
+    if (indent_version_ == version) return;
+    // One scan at a time; poll_indent starts the next when this one is in.
+    if (indent_job_.valid()) {
+        indent_rerun_ = indent_job_version_ != version;
+        return;
+    }
+    auto snap = std::make_shared<std::vector<std::string>>(lines);
+    std::promise<std::vector<FoldRange>> done;
+    indent_job_version_ = version;
+    indent_rerun_       = false;
+    indent_job_ = done.get_future();
+    std::thread([snap, done = std::move(done)]() mutable {
+        done.set_value(compute_indent_folds(*snap));
+    }).detach();
+}
+
+void FoldTree::poll_indent(const std::vector<std::string>& lines, uint64_t version) {
+    if (!indent_job_.valid()) return;
+    if (indent_job_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    uint64_t v = indent_job_version_;
+    auto res = indent_job_.get();
+    if (v == version) install_indent(std::move(res), version);
+    if (indent_rerun_) request_indent(lines, version);
+}
+
+void FoldTree::sync_indent(const std::vector<std::string>& lines,
+                           uint64_t version) {
+    if (indent_version_ == version) return;
+    if (indent_job_.valid() && indent_job_version_ == version) {
+        install_indent(indent_job_.get(), version);
+        return;
+    }
+    install_indent(compute_indent_folds(lines), version);
+}
+
+void FoldTree::install_indent(std::vector<FoldRange> fresh, uint64_t version) {
+    std::unordered_set<int> was_closed;
+    std::vector<FoldRange> manual;
+    for (auto& f : ranges()) {
+        if (f.kind == FoldKind::Manual) manual.push_back(f);
+        else if (f.closed)              was_closed.insert(f.start);
+    }
+    clear();
+    for (auto& f : manual) add(f.start, f.end, f.kind, f.closed);
+    for (auto& f : fresh) {
+        if (find(f.start).n >= 0) continue; // manual fold wins
+        add(f.start, f.end, FoldKind::Indent, was_closed.count(f.start) > 0);
+    }
+    indent_version_ = version;
+}
@@ -0,0 +1,225 @@
+// jobs.cpp — async shell jobs: posix_spawn + a poll() reactor thread
+#include "jobs.h"
+#include "trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+static void set_flags(int fd, int fd_flags, int fl_flags) {
+    if (fd_flags) fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | fd_flags);
+    if (fl_flags) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | fl_flags);
+}
+
+JobManager::JobManager(Post post, int max_running)
+    : post_(std::move(post)), max_running_(std::max(1, max_running)) {
+    if (pipe(wake_) == 0) {
+        set_flags(wake_[0], FD_CLOEXEC, O_NONBLOCK);
+        set_flags(wake_[1], FD_CLOEXEC, O_NONBLOCK);
+    }
+    thread_ = std::thread([this] { reactor(); });
+}
+
+JobManager::~JobManager() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    wake();
+    if (thread_.joinable()) thread_.join();
+    for (auto& [id, job] : running_) {
+        kill(-job->pid, SIGKILL);
+        if (job->out >= 0) close(job->out);
+        if (job->err >= 0) close(job->err);
+        waitpid(job->pid, nullptr, 0);
+    }
+    close(wake_[0]);
+    close(wake_[1]);
+}
+
+void JobManager::wake() {
+    char c = 0;
+    (void)!write(wake_[1], &c, 1);
+}
+
+int JobManager::spawn(const std::string& cmd, JobHandlers handlers) {
+    auto job = std::make_shared<Job>();
+    job->cmd      = cmd;
+    job->handlers = std::move(handlers);
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        job->id = next_id_++;
+        queued_.push_back(job);
+    }
+    wake();
+    return job->id;
+}
+
+bool JobManager::cancel(int id) {
+    std::shared_ptr<Job> dropped;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto run = running_.find(id);
+        if (run != running_.end()) {
+            kill(-run->second->pid, SIGTERM);
+            return true;
+        }
+        auto q = std::find_if(queued_.begin(), queued_.end(),
+                              [id](auto& j) { return j->id == id; });
+        if (q == queued_.end()) return false;
+        dropped = *q;
+        queued_.erase(q);
+    }
+    finish(dropped, -1);
+    return true;
+}
+
+void JobManager::set_max_running(int n) {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        max_running_ = std::max(1, n);
+    }
+    wake();
+}
+
+std::vector<JobInfo> JobManager::list() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::vector<JobInfo> out;
+    for (auto& [id, j] : running_) out.push_back({id, j->cmd, true});
+    for (auto& j : queued_) out.push_back({j->id, j->cmd, false});
+    return out;
+}
+
+void JobManager::finish(const std::shared_ptr<Job>& job, int status) {
+    post_([job, status] {
+        if (job->handlers.on_exit) job->handlers.on_exit(status);
+    });
+}
+
+// Runs /bin/sh -c cmd with stdin from /dev/null and both outputs piped back.
+bool JobManager::start(const std::shared_ptr<Job>& job) {
+    TraceScope trace_scope("JobManager::start");
+    int out[2], err[2];
+    if (pipe(out) != 0) return false;
+    if (pipe(err) != 0) {
+        close(out[0]);
+        close(out[1]);
+        return false;
+    }
+    for (int fd : {out[0], out[1], err[0], err[1]}) set_flags(fd, FD_CLOEXEC, 0);
+
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, out[1], 1);
+    posix_spawn_file_actions_adddup2(&fa, err[1], 2);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    const char* argv[] = {"/bin/sh", "-c", job->cmd.c_str(), nullptr};
+    int rc = posix_spawn(&job->pid, "/bin/sh", &fa, &attr, (char* const*)argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    close(out[1]);
+    close(err[1]);
+    if (rc != 0) {
+        close(out[0]);
+        close(err[0]);
+        return false;
+    }
+    set_flags(out[0], 0, O_NONBLOCK);
+    set_flags(err[0], 0, O_NONBLOCK);
+    job->out = out[0];
+    job->err = err[0];
+    return true;
+}
+
+void JobManager::reactor() {
+    std::vector<pollfd>               fds;
+    std::vector<std::shared_ptr<Job>> owners; // parallel to fds[1..]
+    std::vector<char>                 buf(64 * 1024);
+
+    for (;;) {
+        bool reaping = false;
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            if (stop_) return;
+            while (!queued_.empty() && (int)running_.size() < max_running_) {
+                auto job = queued_.front();
+                queued_.pop_front();
+                lk.unlock();
+                bool ok = start(job);
+                lk.lock();
+                if (ok) {
+                    running_[job->id] = job;
+                } else {
+                    auto h = job;
+                    post_([h] {
+                        if (h->handlers.on_output)
+                            h->handlers.on_output(JobStream::Stderr, "cannot start: " + h->cmd + "\n");
+                        if (h->handlers.on_exit) h->handlers.on_exit(-1);
+                    });
+                }
+            }
+            fds.assign(1, {wake_[0], POLLIN, 0});
+            owners.clear();
+            for (auto& [id, job] : running_) {
+                for (int fd : {job->out, job->err}) {
+                    if (fd < 0) continue;
+                    fds.push_back({fd, POLLIN, 0});
+                    owners.push_back(job);
+                }
+                if (job->out < 0 && job->err < 0) reaping = true;
+            }
+        }
+
+        // Output closed but process not yet reaped: poll briefly and retry.
+        if (poll(fds.data(), fds.size(), reaping ? 20 : -1) < 0 && errno != EINTR)
+            continue;
+        if (fds[0].revents) {
+            char drain[64];
+            while (read(wake_[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (!fds[i].revents) continue;
+            auto& job   = owners[i - 1];
+            int&  fd    = fds[i].fd == job->out ? job->out : job->err;
+            auto stream = &fd == &job->out ? JobStream::Stdout : JobStream::Stderr;
+            ssize_t n;
+            while ((n = read(fd, buf.data(), buf.size())) > 0) {
+                std::string chunk(buf.data(), n);
+                post_([job, stream, chunk = std::move(chunk)] {
+                    if (job->handlers.on_output) job->handlers.on_output(stream, chunk);
+                });
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(mu_);
+        for (auto it = running_.begin(); it != running_.end();) {
+            auto job = it->second;
+            int  st  = 0;
+            pid_t r  = job->out < 0 && job->err < 0 ? waitpid(job->pid, &st, WNOHANG) : 0;
+            if (r == 0) {
+                ++it;
+                continue;
+            }
+            it = running_.erase(it);
+            finish(job, r < 0             ? -1
+                        : WIFEXITED(st)   ? WEXITSTATUS(st)
+                        : WIFSIGNALED(st) ? 128 + WTERMSIG(st) : -1);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+// keymap.cpp — normal-mode key trie with count prefixes
+#include "keymap.h"
+#include <algorithm>
+
+std::vector<std::string> split_keys(const std::string& seq) {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < seq.size();) {
+        size_t n = 1;
+        while (i + n < seq.size() && ((unsigned char)seq[i + n] & 0xC0) == 0x80) ++n;
+        keys.push_back(seq.substr(i, n));
+        i += n;
+    }
+    return keys;
+}
+
+// ── Keymap ───────────────────────────────────────────────────────────────────
+
+void Keymap::bind(const std::string& seq, KeyAction fn) {
+    int node = ROOT;
+    for (auto& k : split_keys(seq)) {
+        int n = next(node, k);
+        if (n < 0) {
+            n = (int)nodes_.size();
+            nodes_[node].next.emplace(k, n);
+            nodes_.emplace_back();
+        }
+        node = n;
+    }
+    if (node != ROOT) nodes_[node].action = std::move(fn);
+}
+
+int Keymap::next(int node, const std::string& key) const {
+    auto& m  = nodes_[node].next;
+    auto  it = m.find(key);
+    return it == m.end() ? -1 : it->second;
+}
+
+const KeyAction* Keymap::action(int node) const {
+    auto& a = nodes_[node].action;
+    return a ? &a : nullptr;
+}
+
+const KeyAction* Keymap::find(const std::string& seq) const {
+    int node = ROOT;
+    for (auto& k : split_keys(seq))
+        if ((node = next(node, k)) < 0) return nullptr;
+    return action(node);
+}
+
+// ── KeyReader ────────────────────────────────────────────────────────────────
+
+KeyReader::Result KeyReader::feed(const Keymap& km, const std::string& key) {
+    using namespace std::chrono;
+    Result r;
+    auto now = steady_clock::now();
+
+    // A stale partial sequence ends: it runs if it is bound on its own.
+    if (node_ != Keymap::ROOT &&
+        duration_cast<milliseconds>(now - last_).count() > timeout_ms_) {
+        if (auto* a = km.action(node_)) {
+            r.action = *a;
+            r.count  = count_;
+            r.again  = true;
+        }
+        reset();
+        if (r.again) return r;
+    }
+    last_ = now;
+
+    // "0" starts a sequence (line start) unless it extends a count.
+    if (node_ == Keymap::ROOT && key.size() == 1 && key[0] >= '0' && key[0] <= '9' &&
+        (key[0] != '0' || count_ > 0)) {
+        count_ = std::min(count_ * 10 + (key[0] - '0'), MAX_COUNT);
+        return r;
+    }
+
+    int n = km.next(node_, key);
+    if (n < 0) {
+        if (node_ == Keymap::ROOT) {
+            reset();
+            r.consumed = false;
+            return r;
+        }
+        // "dj": the prefix is dropped (or run, if bound) and j starts afresh.
+        if (auto* a = km.action(node_)) {
+            r.action = *a;
+            r.count  = count_;
+        }
+        r.again = true;
+        reset();
+        return r;
+    }
+    if (km.has_next(n)) {
+        node_ = n;
+        return r;
+    }
+    if (auto* a = km.action(n)) {
+        r.action = *a;
+        r.count  = count_;
+    }
+    reset();
+    return r;
+}
+
+int KeyReader::take_count() {
+    int c = count_;
+    reset();
+    return c;
+}
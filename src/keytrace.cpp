@@ -0,0 +1,182 @@
+// keytrace.cpp — key trace recording, loading and headless replay
+#include "keytrace.h"
+#include "trace.h"
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/screen/screen.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+using namespace ftxui;
+
+ftxui::Event to_event(const KeyTraceEvent& k) {
+    return k.character ? Event::Character(k.input) : Event::Special(k.input);
+}
+
+// ── File format ──────────────────────────────────────────────────────────────
+
+static std::string to_hex(const std::string& s) {
+    static const char* digits = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : s) {
+        out += digits[c >> 4];
+        out += digits[c & 15];
+    }
+    return out;
+}
+
+static bool from_hex(const std::string& h, std::string& out) {
+    if (h.size() % 2) return false;
+    auto nibble = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    out.clear();
+    for (size_t i = 0; i < h.size(); i += 2) {
+        int hi = nibble(h[i]), lo = nibble(h[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out += (char)(hi << 4 | lo);
+    }
+    return true;
+}
+
+bool save_key_trace(const std::string& path, const std::vector<KeyTraceEvent>& events) {
+    std::ofstream f(path);
+    if (!f.is_open()) return false;
+    for (auto& e : events)
+        f << e.delay_us << ' ' << (e.character ? 'c' : 's') << ' ' << to_hex(e.input) << '\n';
+    return (bool)f;
+}
+
+bool load_key_trace(const std::string& path, std::vector<KeyTraceEvent>& events,
+                    std::string& err) {
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        err = "cannot open " + path;
+        return false;
+    }
+    events.clear();
+    std::string line;
+    for (int n = 1; std::getline(f, line); ++n) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ls(line);
+        KeyTraceEvent e;
+        char kind = 0;
+        std::string hex;
+        if (!(ls >> e.delay_us >> kind >> hex) || (kind != 'c' && kind != 's') ||
+            !from_hex(hex, e.input)) {
+            err = path + ":" + std::to_string(n) + ": malformed event";
+            return false;
+        }
+        e.character = kind == 'c';
+        events.push_back(std::move(e));
+    }
+    return true;
+}
+
+// ── KeyRecorder ──────────────────────────────────────────────────────────────
+
+void KeyRecorder::start() {
+    events_.clear();
+    last_   = std::chrono::steady_clock::now();
+    active_ = true;
+}
+
+void KeyRecorder::note(const ftxui::Event& e) {
+    if (!active_ || e.is_mouse() || e.is_cursor_position() || e.input().empty())
+        return;
+    auto now = std::chrono::steady_clock::now();
+    auto gap = std::chrono::duration_cast<std::chrono::microseconds>(now - last_);
+    last_ = now;
+    events_.push_back({(uint64_t)gap.count(), e.is_character(), e.input()});
+}
+
+bool KeyRecorder::stop(const std::string& path) {
+    active_ = false;
+    return save_key_trace(path, events_);
+}
+
+// ── Replay ───────────────────────────────────────────────────────────────────
+
+std::string ReplayReport::summary() const {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%zu events in %.1f ms (%.0f ev/s)  mean %.1f  p50 %.1f  p95 %.1f  "
+                  "p99 %.1f  max %.1f us",
+                  events, total_ms, events_per_s(), mean_us, p50_us, p95_us, p99_us, max_us);
+    return line;
+}
+
+std::string ReplayReport::to_json() const {
+    std::ostringstream os;
+    char num[64];
+    auto fmt = [&](double v) {
+        std::snprintf(num, sizeof(num), "%.3f", v);
+        return num;
+    };
+    os << "{\n  \"events\": " << events;
+    os << ",\n  \"total_ms\": " << fmt(total_ms);
+    os << ",\n  \"events_per_s\": " << fmt(events_per_s());
+    os << ",\n  \"mean_us\": " << fmt(mean_us);
+    os << ", \"p50_us\": " << fmt(p50_us);
+    os << ", \"p95_us\": " << fmt(p95_us);
+    os << ", \"p99_us\": " << fmt(p99_us);
+    os << ", \"max_us\": " << fmt(max_us);
+    os << ",\n  \"latency_us\": [";
+    for (size_t i = 0; i < latency_us.size(); ++i)
+        os << (i ? ", " : "") << fmt(latency_us[i]);
+    os << "]\n}\n";
+    return os.str();
+}
+
+ReplayReport replay_key_trace(ftxui::Component root,
+                              const std::vector<KeyTraceEvent>& events,
+                              const ReplayOptions& opts,
+                              const std::function<bool()>& done) {
+    using Clock = std::chrono::steady_clock;
+    auto screen = Screen::Create(Dimension::Fixed(opts.width), Dimension::Fixed(opts.height));
+    size_t sink = 0; // keeps ToString from being optimised out
+
+    auto frame = [&] {
+        Render(screen, root->Render());
+        sink += screen.ToString().size();
+    };
+    frame(); // initial paint isn't part of any event
+
+    ReplayReport r;
+    r.latency_us.reserve(events.size());
+    for (auto& k : events) {
+        if (done && done()) break;
+        if (opts.realtime && k.delay_us)
+            std::this_thread::sleep_for(std::chrono::microseconds(k.delay_us));
+        auto t0 = Clock::now();
+        {
+            TraceScope trace_scope("replay_event");
+            root->OnEvent(to_event(k));
+            frame();
+        }
+        r.latency_us.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+    }
+    (void)sink;
+
+    r.events = r.latency_us.size();
+    if (!r.events) return r;
+    double total_us = std::accumulate(r.latency_us.begin(), r.latency_us.end(), 0.0);
+    r.total_ms = total_us / 1000.0;
+    r.mean_us  = total_us / r.events;
+
+    std::vector<double> v = r.latency_us;
+    std::sort(v.begin(), v.end());
+    auto pct = [&](double q) { return v[std::min(v.size() - 1, (size_t)(q * v.size()))]; };
+    r.p50_us = pct(0.50);
+    r.p95_us = pct(0.95);
+    r.p99_us = pct(0.99);
+    r.max_us = v.back();
+    return r;
+}
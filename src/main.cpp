@@ -1,12 +1,58 @@
 #include "app.h"
+#include <cstdio>
+#include <cstring>
 
 int main(int argc, char* argv[]) {
+    startup_profile().begin();
+    if (argc > 1 && std::strcmp(argv[1], "--batch") == 0) {
+        BatchOptions batch;
+        std::string  err;
+        if (!parse_batch_args(argc, argv, 2, batch, err)) {
+            std::fprintf(stderr, "slate: %s\n", err.c_str());
+            return 2;
+        }
+        return run_batch(batch);
+    }
     VedApp app;
-    if (argc > 1) {
-        for (int i = 1; i < argc; i++) {
-            app.open_file(argv[i]);
+    std::string   replay_path, report_path;
+    ReplayOptions replay;
+    bool          startup_report = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--perf-dump") == 0 && i + 1 < argc) {
+            app.set_perf_dump(argv[++i]);
+            continue;
+        }
+        if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+            continue;
+        }
+        if (std::strcmp(argv[i], "--replay-report") == 0 && i + 1 < argc) {
+            report_path = argv[++i];
+            continue;
+        }
+        if (std::strcmp(argv[i], "--replay-size") == 0 && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &replay.width, &replay.height) != 2 ||
+                replay.width <= 0 || replay.height <= 2) {
+                std::fprintf(stderr, "slate: --replay-size wants WxH\n");
+                return 1;
+            }
+            continue;
+        }
+        if (std::strcmp(argv[i], "--startup-profile") == 0) {
+            startup_report = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--replay-realtime") == 0) {
+            replay.realtime = true;
+            continue;
         }
+        app.open_file(argv[i]);
     }
+    startup_profile().mark("open files");
+    if (!replay_path.empty())
+        return app.run_replay(replay_path, replay, report_path);
     app.run();
+    if (startup_report)
+        std::fprintf(stderr, "%s", startup_profile().report().c_str());
     return 0;
 }
@@ -0,0 +1,293 @@
+// perf.cpp — phase timing histograms behind :perf
+#include "perf.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+const char* perf_phase_name(PerfPhase p) {
+    switch (p) {
+    case PerfPhase::Event:      return "event";
+    case PerfPhase::Script:     return "script";
+    case PerfPhase::Render:     return "render";
+    case PerfPhase::RenderLine: return "render_line";
+    case PerfPhase::Flush:      return "flush";
+    case PerfPhase::Keystroke:  return "keystroke";
+    case PerfPhase::Count:      break;
+    }
+    return "?";
+}
+
+// ── Allocation counters ──────────────────────────────────────────────────────
+// Plain atomics and a trivially-constructed thread_local: nothing here may
+// allocate, since operator new calls straight in.
+
+static constexpr int ALLOC_SLOTS = (int)PerfPhase::Count + 1;
+static std::atomic<uint64_t> g_allocs[ALLOC_SLOTS];
+static std::atomic<uint64_t> g_frees[ALLOC_SLOTS];
+static std::atomic<uint64_t> g_alloc_bytes[ALLOC_SLOTS];
+static thread_local int      t_alloc_phase = (int)PerfPhase::Count;
+
+void alloc_note_new(size_t bytes) {
+    g_allocs[t_alloc_phase].fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes[t_alloc_phase].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void alloc_note_delete() {
+    g_frees[t_alloc_phase].fetch_add(1, std::memory_order_relaxed);
+}
+
+int  alloc_phase()               { return t_alloc_phase; }
+void set_alloc_phase(int phase)  { t_alloc_phase = phase; }
+
+AllocTotals alloc_totals(int phase) {
+    return {g_allocs[phase].load(std::memory_order_relaxed),
+            g_frees[phase].load(std::memory_order_relaxed),
+            g_alloc_bytes[phase].load(std::memory_order_relaxed)};
+}
+
+AllocTotals alloc_totals_all() {
+    AllocTotals t;
+    for (int i = 0; i < ALLOC_SLOTS; ++i) {
+        auto a = alloc_totals(i);
+        t.allocs += a.allocs;
+        t.frees  += a.frees;
+        t.bytes  += a.bytes;
+    }
+    return t;
+}
+
+void alloc_reset() {
+    for (int i = 0; i < ALLOC_SLOTS; ++i) {
+        g_allocs[i] = 0;
+        g_frees[i] = 0;
+        g_alloc_bytes[i] = 0;
+    }
+}
+
+// ── PerfStats ────────────────────────────────────────────────────────────────
+
+PerfStats& perf_stats() {
+    static PerfStats stats;
+    return stats;
+}
+
+void PerfStats::reset() {
+    for (auto& s : series_) s = Series{};
+    key_allocs_last_ = key_allocs_sum_ = {};
+    keys_ = 0;
+    alloc_reset();
+}
+
+void PerfStats::record_keystroke_allocs(const AllocTotals& delta) {
+    key_allocs_last_ = delta;
+    key_allocs_sum_.allocs += delta.allocs;
+    key_allocs_sum_.frees  += delta.frees;
+    key_allocs_sum_.bytes  += delta.bytes;
+    keys_++;
+}
+
+AllocTotals PerfStats::keystroke_allocs_mean() const {
+    if (!keys_) return {};
+    return {key_allocs_sum_.allocs / keys_, key_allocs_sum_.frees / keys_,
+            key_allocs_sum_.bytes / keys_};
+}
+
+void PerfStats::record(PerfPhase p, std::chrono::nanoseconds d) {
+    auto& s = series_[(size_t)p];
+    uint64_t ns = (uint64_t)std::max<int64_t>(0, d.count());
+    s.window[s.count % WINDOW] = ns;
+    int b = 0;
+    while (b < BUCKETS - 1 && (ns >> (b + 1)) != 0) ++b;
+    s.buckets[b]++;
+    s.count++;
+    s.total_ns += ns;
+    s.max_ns = std::max(s.max_ns, ns);
+}
+
+PerfSummary PerfStats::summary(PerfPhase p) const {
+    const auto& s = series_[(size_t)p];
+    PerfSummary out;
+    out.count = s.count;
+    if (!s.count) return out;
+    out.mean_us = s.total_ns / 1000.0 / s.count;
+    out.max_us  = s.max_ns / 1000.0;
+
+    size_t n = std::min<uint64_t>(s.count, WINDOW);
+    std::vector<uint64_t> v(s.window.begin(), s.window.begin() + n);
+    auto pct = [&](double q) {
+        size_t k = std::min(n - 1, (size_t)(q * n));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k] / 1000.0;
+    };
+    out.p50_us = pct(0.50);
+    out.p95_us = pct(0.95);
+    out.p99_us = pct(0.99);
+    return out;
+}
+
+std::string PerfStats::to_json() const {
+    std::ostringstream os;
+    char num[64];
+    os << "{\n";
+    for (int i = 0; i < (int)PerfPhase::Count; ++i) {
+        auto p = (PerfPhase)i;
+        auto s = summary(p);
+        std::snprintf(num, sizeof(num), "%.3f", s.mean_us);
+        os << "  \"" << perf_phase_name(p) << "\": {\"count\": " << s.count
+           << ", \"mean_us\": " << num;
+        std::snprintf(num, sizeof(num), "%.3f", s.p50_us);
+        os << ", \"p50_us\": " << num;
+        std::snprintf(num, sizeof(num), "%.3f", s.p95_us);
+        os << ", \"p95_us\": " << num;
+        std::snprintf(num, sizeof(num), "%.3f", s.p99_us);
+        os << ", \"p99_us\": " << num;
+        std::snprintf(num, sizeof(num), "%.3f", s.max_us);
+        os << ", \"max_us\": " << num << ", \"hist_log2_ns\": [";
+        const auto& b = series_[i].buckets;
+        int last = BUCKETS - 1;
+        while (last > 0 && !b[last]) --last;
+        for (int k = 0; k <= last; ++k) os << (k ? ", " : "") << b[k];
+        os << "]}" << (i + 1 < (int)PerfPhase::Count || kAllocStats ? "," : "")
+           << "\n";
+    }
+    if (kAllocStats) {
+        os << "  \"allocs\": {";
+        for (int i = 0; i <= (int)PerfPhase::Count; ++i) {
+            auto a = alloc_totals(i);
+            const char* name =
+                i < (int)PerfPhase::Count ? perf_phase_name((PerfPhase)i) : "other";
+            os << (i ? ", " : "") << "\"" << name << "\": {\"allocs\": " << a.allocs
+               << ", \"frees\": " << a.frees << ", \"bytes\": " << a.bytes << "}";
+        }
+        auto k = keystroke_allocs_mean();
+        os << ", \"per_keystroke_mean\": {\"allocs\": " << k.allocs
+           << ", \"bytes\": " << k.bytes << ", \"keystrokes\": " << keys_ << "}}\n";
+    }
+    os << "}\n";
+    return os.str();
+}
+
+bool PerfStats::dump(const std::string& path) const {
+    std::ofstream f(path);
+    if (!f.is_open()) return false;
+    f << to_json();
+    return (bool)f;
+}
+
+// ── CallbackProfiler ─────────────────────────────────────────────────────────
+
+// Per thread: each --batch thread has its own editor VM and callbacks.
+CallbackProfiler& callback_profiler() {
+    thread_local CallbackProfiler profiler;
+    return profiler;
+}
+
+void CallbackProfiler::tag(const void* key, const std::string& kind,
+                           const std::string& owner) {
+    stats_[key] = CallbackStats{owner.empty() ? owner_ : owner, kind};
+}
+
+bool CallbackProfiler::record(const void* key, uint64_t ns, uint64_t vm_bytes) {
+    auto& s = stats_[key];
+    if (s.kind.empty()) s.kind = "?";
+    if (s.owner.empty()) s.owner = "?";
+    s.calls++;
+    s.total_ns += ns;
+    s.max_ns    = std::max(s.max_ns, ns);
+    s.vm_bytes += vm_bytes;
+    return budget_ms_ > 0 && ns > budget_ms_ * 1e6;
+}
+
+bool CallbackProfiler::strike(const void* key) {
+    auto& s = stats_[key];
+    if (s.disabled) return false;
+    s.disabled = ++s.strikes >= max_strikes_;
+    return s.disabled;
+}
+
+const CallbackStats* CallbackProfiler::find(const void* key) const {
+    auto it = stats_.find(key);
+    return it == stats_.end() ? nullptr : &it->second;
+}
+
+void CallbackProfiler::reset() {
+    for (auto& [key, s] : stats_) s = CallbackStats{s.owner, s.kind};
+}
+
+std::vector<CallbackStats> CallbackProfiler::by_cost() const {
+    std::vector<CallbackStats> v;
+    for (auto& [key, s] : stats_)
+        if (s.calls || s.disabled) v.push_back(s);
+    std::sort(v.begin(), v.end(), [](auto& a, auto& b) { return a.total_ns > b.total_ns; });
+    return v;
+}
+
+std::string CallbackProfiler::report() const {
+    auto v = by_cost();
+    if (v.empty()) return "no plugin callbacks have run";
+    std::ostringstream os;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%8s %10s %9s %9s %9s  %s\n",
+                  "calls", "total ms", "mean us", "max us", "KiB", "callback");
+    os << line;
+    for (auto& s : v) {
+        std::snprintf(line, sizeof(line), "%8llu %10.2f %9.1f %9.1f %9.1f  %s: %s%s\n",
+                      (unsigned long long)s.calls, s.total_ns / 1e6,
+                      s.calls ? s.total_ns / 1e3 / s.calls : 0.0, s.max_ns / 1e3,
+                      s.vm_bytes / 1024.0, s.owner.c_str(), s.kind.c_str(),
+                      s.disabled ? "  [disabled]" : "");
+        os << line;
+    }
+    if (budget_ms_ > 0) {
+        std::snprintf(line, sizeof(line), "budget %.1f ms\n", budget_ms_);
+        os << line;
+    }
+    if (watchdog_ms_ > 0) {
+        std::snprintf(line, sizeof(line), "watchdog %.0f ms, %d strikes\n", watchdog_ms_,
+                      max_strikes_);
+        os << line;
+    }
+    return os.str();
+}
+
+// ── StartupProfile ───────────────────────────────────────────────────────────
+
+StartupProfile& startup_profile() {
+    static StartupProfile profile;
+    return profile;
+}
+
+void StartupProfile::begin() {
+    owner_ = std::this_thread::get_id();
+    start_ = last_ = std::chrono::steady_clock::now();
+    entries_.clear();
+}
+
+void StartupProfile::mark(const char* phase) {
+    if (std::this_thread::get_id() != owner_) return;
+    auto now = std::chrono::steady_clock::now();
+    entries_.push_back(
+        {phase, std::chrono::duration<double, std::milli>(now - last_).count(), false});
+    last_ = now;
+}
+
+void StartupProfile::milestone(const char* name) {
+    if (std::this_thread::get_id() != owner_) return;
+    entries_.push_back(
+        {name, std::chrono::duration<double, std::milli>(last_ - start_).count(), true});
+}
+
+std::string StartupProfile::report() const {
+    std::ostringstream os;
+    char line[96];
+    os << "startup profile (ms)\n";
+    for (auto& e : entries_) {
+        std::snprintf(line, sizeof(line), e.milestone ? "  = %-16s %8.2f\n"
+                                                      : "    %-16s %8.2f\n",
+                      e.name, e.ms);
+        os << line;
+    }
+    return os.str();
+}
@@ -1,7 +1,18 @@
 // scripting.cpp — Wren scripting engine + all foreign method bindings
 #include "scripting.h"
 #include "app.h"
+#include "buffer.h"
+#include "perf.h"
+#include "trace.h"
+#include "worker.h"
 #include <wren.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
@@ -13,6 +24,29 @@ namespace fs = std::filesystem;
 //  Foreign method implementations
 // ════════════════════════════════════════════════════════════════════════════
 
+// Handles given to the editor are counted so leaks show up in :vm; they go
+// back through ScriptingEngine::release. Per thread, like the watchdog state
+// below: --batch runs an editor VM on each pool thread.
+static thread_local size_t g_live_handles = 0;
+
+static WrenHandle* slot_handle(WrenVM* vm, int slot) {
+    ++g_live_handles;
+    return wrenGetSlotHandle(vm, slot);
+}
+
+static WrenHandle* call_handle(WrenVM* vm, const char* signature) {
+    ++g_live_handles;
+    return wrenMakeCallHandle(vm, signature);
+}
+
+// Handle for a callback argument, registered with the callback profiler under
+// the plugin currently loading or running.
+static WrenHandle* tagged_handle(WrenVM* vm, int slot, const std::string& kind) {
+    WrenHandle* h = slot_handle(vm, slot);
+    callback_profiler().tag(h, kind);
+    return h;
+}
+
 // ── Existing ─────────────────────────────────────────────────────────────────
 
 static void slate_api_version(WrenVM* vm) {
@@ -70,6 +104,72 @@ static void slate_delete_line(WrenVM* vm) {
     app->delete_line(n);
 }
 
+// ── Batched buffer access ─────────────────────────────────────────────────────
+
+static void abort_fiber(WrenVM* vm, const char* msg) {
+    wrenSetSlotString(vm, 0, msg);
+    wrenAbortFiber(vm, 0);
+}
+
+// Reads a List of Strings from 'slot'; aborts the fiber on anything else.
+static bool get_string_list(WrenVM* vm, int slot, std::vector<std::string>& out) {
+    if (wrenGetSlotType(vm, slot) != WREN_TYPE_LIST) {
+        abort_fiber(vm, "expected a List of strings");
+        return false;
+    }
+    int n   = wrenGetListCount(vm, slot);
+    int tmp = wrenGetSlotCount(vm);
+    wrenEnsureSlots(vm, tmp + 1);
+    out.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        wrenGetListElement(vm, slot, i, tmp);
+        if (wrenGetSlotType(vm, tmp) != WREN_TYPE_STRING) {
+            abort_fiber(vm, "expected a List of strings");
+            return false;
+        }
+        int len = 0;
+        const char* bytes = wrenGetSlotBytes(vm, tmp, &len);
+        out.emplace_back(bytes, len);
+    }
+    return true;
+}
+
+static void slate_get_lines(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int a = (int)wrenGetSlotDouble(vm, 1);
+    int b = (int)wrenGetSlotDouble(vm, 2);
+    auto lines = app->get_lines(a, b);
+    wrenEnsureSlots(vm, 2);
+    wrenSetSlotNewList(vm, 0);
+    for (auto& l : lines) {
+        wrenSetSlotBytes(vm, 1, l.data(), l.size());
+        wrenInsertInList(vm, 0, -1, 1);
+    }
+}
+
+static void slate_set_lines(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int n = (int)wrenGetSlotDouble(vm, 1);
+    std::vector<std::string> lines;
+    if (get_string_list(vm, 2, lines)) app->set_lines(n, std::move(lines));
+}
+
+static void slate_replace_range(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int a = (int)wrenGetSlotDouble(vm, 1);
+    int b = (int)wrenGetSlotDouble(vm, 2);
+    std::vector<std::string> lines;
+    if (get_string_list(vm, 3, lines)) app->replace_range(a, b, std::move(lines));
+}
+
+static void slate_begin_transaction(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->begin_transaction();
+}
+
+static void slate_end_transaction(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->end_transaction();
+}
+
 static void slate_get_cursor(WrenVM* vm) {
     wrenSetSlotString(vm, 0, ((VedApp*)wrenGetUserData(vm))->get_cursor().c_str());
 }
@@ -137,6 +237,83 @@ static void slate_exec(WrenVM* vm) {
     wrenSetSlotString(vm, 0, r.c_str());
 }
 
+static void slate_spawn(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    const char* cmd = wrenGetSlotString(vm, 1);
+    WrenHandle* receiver = tagged_handle(vm, 2, "spawn " + std::string(cmd));
+    WrenHandle* method   = call_handle(vm, "call(_,_)");
+    wrenSetSlotDouble(vm, 0, (double)app->spawn_job(cmd, receiver, method));
+}
+
+static void slate_spawn_to_buffer(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    std::string cmd  = wrenGetSlotString(vm, 1);
+    std::string name = wrenGetSlotString(vm, 2);
+    wrenSetSlotDouble(vm, 0, (double)app->spawn_job_to_buffer(cmd, name));
+}
+
+static void slate_cancel_job(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    bool ok = app->cancel_job((int)wrenGetSlotDouble(vm, 1));
+    wrenSetSlotDouble(vm, 0, ok ? 1.0 : 0.0);
+}
+
+static void slate_set_job_limit(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->set_job_limit((int)wrenGetSlotDouble(vm, 1));
+}
+
+static void slate_job_count(WrenVM* vm) {
+    wrenSetSlotDouble(vm, 0, (double)((VedApp*)wrenGetUserData(vm))->job_count());
+}
+
+// ── Async ─────────────────────────────────────────────────────────────────────
+
+static void slate_wake_after(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    WrenHandle* task = slot_handle(vm, 1);
+    app->wake_task(task, (int)wrenGetSlotDouble(vm, 2));
+}
+
+static void slate_await_job(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    WrenHandle* task = slot_handle(vm, 1);
+    app->await_job(task, wrenGetSlotString(vm, 2));
+}
+
+// ── Workers ───────────────────────────────────────────────────────────────────
+
+static void slate_spawn_worker(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    std::string path = wrenGetSlotString(vm, 1);
+    WrenHandle* receiver = tagged_handle(vm, 2, "spawnWorker " + path);
+    WrenHandle* method   = call_handle(vm, "call(_)");
+    wrenSetSlotDouble(vm, 0, (double)app->spawn_worker(path, receiver, method));
+}
+
+static void slate_post_to_worker(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int id = (int)wrenGetSlotDouble(vm, 1);
+    WorkerMsg msg;
+    std::string err;
+    if (!read_worker_msg(vm, 2, msg, err)) {
+        abort_fiber(vm, err.c_str());
+        return;
+    }
+    wrenSetSlotDouble(vm, 0, app->post_to_worker(id, std::move(msg)) ? 1.0 : 0.0);
+}
+
+static void slate_post_snapshot_to_worker(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    bool ok = app->post_snapshot_to_worker((int)wrenGetSlotDouble(vm, 1));
+    wrenSetSlotDouble(vm, 0, ok ? 1.0 : 0.0);
+}
+
+static void slate_stop_worker(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    bool ok = app->stop_worker((int)wrenGetSlotDouble(vm, 1));
+    wrenSetSlotDouble(vm, 0, ok ? 1.0 : 0.0);
+}
+
 static void slate_save_file(WrenVM* vm) {
     ((VedApp*)wrenGetUserData(vm))->save_file();
 }
@@ -163,52 +340,60 @@ static void slate_new_buffer(WrenVM* vm) {
 static void slate_bind_command(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
     const char* name = wrenGetSlotString(vm, 1);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 2);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call(_)");
+    WrenHandle* receiver = tagged_handle(vm, 2, "bindCommand " + std::string(name));
+    WrenHandle* method   = call_handle(vm, "call(_)");
     app->bind_wren_command(name, receiver, method);
 }
 
 static void slate_bind_key(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
     const char* key     = wrenGetSlotString(vm, 1);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 2);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call(_,_)");
+    WrenHandle* receiver = tagged_handle(vm, 2, "bindKey " + std::string(key));
+    WrenHandle* method   = call_handle(vm, "call(_,_)");
     app->bind_wren_key(key, receiver, method);
 }
 
 static void slate_bind_insert_key(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
     const char* key     = wrenGetSlotString(vm, 1);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 2);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call(_)");
+    WrenHandle* receiver = tagged_handle(vm, 2, "bindInsertKey " + std::string(key));
+    WrenHandle* method   = call_handle(vm, "call(_)");
     app->bind_wren_insert_key(key, receiver, method);
 }
 
 static void slate_bind_on_change(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 1);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call()");
+    WrenHandle* receiver = tagged_handle(vm, 1, "bindOnChange");
+    WrenHandle* method   = call_handle(vm, "call()");
     app->bind_wren_on_change(receiver, method);
 }
 
+static void slate_bind_on_change_debounced(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int delay_ms = (int)wrenGetSlotDouble(vm, 1);
+    WrenHandle* receiver = tagged_handle(vm, 2, "bindOnChangeDebounced");
+    WrenHandle* method   = call_handle(vm, "call(_)");
+    app->bind_wren_on_change_debounced(delay_ms, receiver, method);
+}
+
 static void slate_bind_on_save(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 1);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call()");
+    WrenHandle* receiver = tagged_handle(vm, 1, "bindOnSave");
+    WrenHandle* method   = call_handle(vm, "call()");
     app->bind_wren_on_save(receiver, method);
 }
 
 static void slate_bind_on_open(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 1);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call()");
+    WrenHandle* receiver = tagged_handle(vm, 1, "bindOnOpen");
+    WrenHandle* method   = call_handle(vm, "call()");
     app->bind_wren_on_open(receiver, method);
 }
 
 static void slate_bind_on_mode_change(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 1);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call(_,_)");
+    WrenHandle* receiver = tagged_handle(vm, 1, "bindOnModeChange");
+    WrenHandle* method   = call_handle(vm, "call(_,_)");
     app->bind_wren_on_mode_change(receiver, method);
 }
 
@@ -216,9 +401,39 @@ static void slate_bind_on_mode_change(WrenVM* vm) {
 
 static void slate_add_status_seg(WrenVM* vm) {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
-    WrenHandle* receiver = wrenGetSlotHandle(vm, 1);
-    WrenHandle* method   = wrenMakeCallHandle(vm, "call()");
-    app->add_wren_status_seg(receiver, method);
+    WrenHandle* receiver = tagged_handle(vm, 1, "addStatusSegment");
+    WrenHandle* method   = call_handle(vm, "call()");
+    wrenSetSlotDouble(vm, 0, (double)app->add_wren_status_seg(receiver, method));
+}
+
+// refresh: "change save mode open cursor every:<ms> manual", any subset
+static void slate_add_status_seg_on(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    std::istringstream ss(wrenGetSlotString(vm, 1));
+    unsigned refresh = 0;
+    int every_ms = 0;
+    for (std::string t; ss >> t;) {
+        if (t == "change")      refresh |= SEG_CHANGE;
+        else if (t == "save")   refresh |= SEG_SAVE;
+        else if (t == "mode")   refresh |= SEG_MODE;
+        else if (t == "open")   refresh |= SEG_OPEN;
+        else if (t == "cursor") refresh |= SEG_CURSOR;
+        else if (t.rfind("every:", 0) == 0 && std::atoi(t.c_str() + 6) > 0)
+            every_ms = std::atoi(t.c_str() + 6);
+        else if (t != "manual") {
+            abort_fiber(vm, ("unknown status refresh trigger: " + t).c_str());
+            return;
+        }
+    }
+    WrenHandle* receiver = tagged_handle(vm, 2, "addStatusSegment");
+    WrenHandle* method   = call_handle(vm, "call()");
+    wrenSetSlotDouble(vm, 0,
+                      (double)app->add_wren_status_seg(receiver, method, refresh, every_ms));
+}
+
+static void slate_refresh_status_seg(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    app->refresh_status_seg((int)wrenGetSlotDouble(vm, 1));
 }
 
 static void slate_show_overlay(WrenVM* vm) {
@@ -246,10 +461,131 @@ static void slate_clear_highlight_rules(WrenVM* vm) {
     app->clear_highlight_rules(wrenGetSlotString(vm, 1));
 }
 
+// ── Folding ───────────────────────────────────────────────────────────────────
+
+static void slate_add_fold(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int a = (int)wrenGetSlotDouble(vm, 1);
+    int b = (int)wrenGetSlotDouble(vm, 2);
+    wrenSetSlotDouble(vm, 0, app->add_fold(a, b) ? 1.0 : 0.0);
+}
+
+static void slate_delete_fold(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->delete_fold((int)wrenGetSlotDouble(vm, 1));
+}
+
+static void slate_open_fold(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->open_fold((int)wrenGetSlotDouble(vm, 1));
+}
+
+static void slate_close_fold(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->close_fold((int)wrenGetSlotDouble(vm, 1));
+}
+
+static void slate_toggle_fold(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->toggle_fold((int)wrenGetSlotDouble(vm, 1));
+}
+
+static void slate_open_all_folds(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->set_all_folds(false);
+}
+
+static void slate_close_all_folds(WrenVM* vm) {
+    ((VedApp*)wrenGetUserData(vm))->set_all_folds(true);
+}
+
+static void slate_fold_at(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    wrenSetSlotString(vm, 0, app->fold_at((int)wrenGetSlotDouble(vm, 1)).c_str());
+}
+
+static void slate_is_line_hidden(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    int n = (int)wrenGetSlotDouble(vm, 1);
+    wrenSetSlotDouble(vm, 0, app->is_line_hidden(n) ? 1.0 : 0.0);
+}
+
+// ── Memory ────────────────────────────────────────────────────────────────────
+
+static void set_mem_map(WrenVM* vm, const MemUsage& m, size_t wren_heap) {
+    wrenEnsureSlots(vm, 3);
+    wrenSetSlotNewMap(vm, 0);
+    auto put = [vm](const char* key, size_t v) {
+        wrenSetSlotString(vm, 1, key);
+        wrenSetSlotDouble(vm, 2, (double)v);
+        wrenSetMapValue(vm, 0, 1, 2);
+    };
+    put("text", m.text);
+    put("undo", m.undo);
+    put("redo", m.redo);
+    put("caches", m.caches);
+    put("wrenHeap", wren_heap);
+    put("total", m.total() + wren_heap);
+}
+
+static void slate_memory_usage(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    set_mem_map(vm, app->total_memory(), ScriptingEngine::heap_bytes());
+}
+
+static void slate_buffer_memory(WrenVM* vm) {
+    VedApp* app = (VedApp*)wrenGetUserData(vm);
+    set_mem_map(vm, app->buffer_memory(), 0);
+}
+
+static void slate_vm_stats(WrenVM* vm) {
+    auto st = ((VedApp*)wrenGetUserData(vm))->vm_stats();
+    wrenEnsureSlots(vm, 3);
+    wrenSetSlotNewMap(vm, 0);
+    auto put = [vm](const char* key, double v) {
+        wrenSetSlotString(vm, 1, key);
+        wrenSetSlotDouble(vm, 2, v);
+        wrenSetMapValue(vm, 0, 1, 2);
+    };
+    put("heapBytes", (double)st.heap_bytes);
+    put("heapPeak", (double)st.heap_peak);
+    put("allocs", (double)st.allocs);
+    put("frees", (double)st.frees);
+    put("liveHandles", (double)st.live_handles);
+    put("gcRuns", (double)st.gc_runs);
+    put("gcLastMs", st.gc_last_ms);
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  bind_method dispatch
 // ════════════════════════════════════════════════════════════════════════════
 
+// ── Watchdog ─────────────────────────────────────────────────────────────────
+// The outermost callback on the UI thread gets a deadline. Wren's interpreter
+// loop is not ours to instrument, so the budget is enforced at the next
+// foreign call: every Slate method aborts the fiber once the deadline has
+// passed. This is not a hard ceiling: a loop that never calls into Slate
+// runs until it returns (and is charged a strike then, see ProfiledCall);
+// one that never returns hangs the editor. Cleanup calls are unguarded so
+// a caught abort can still release what the callback holds.
+using WatchClock = std::chrono::steady_clock;
+static thread_local int                    g_call_depth = 0;
+static thread_local WatchClock::time_point g_deadline;
+static thread_local bool                   g_aborted = false;
+
+static bool over_budget() {
+    return g_call_depth > 0 && callback_profiler().watchdog_ms() > 0 &&
+           WatchClock::now() > g_deadline;
+}
+
+template <WrenForeignMethodFn F>
+static void guarded(WrenVM* vm) {
+    if (over_budget()) {
+        g_aborted = true;
+        char msg[96];
+        std::snprintf(msg, sizeof(msg), "script exceeded its %.0f ms budget",
+                      callback_profiler().watchdog_ms());
+        abort_fiber(vm, msg);
+        return;
+    }
+    F(vm);
+}
+
 /*static*/ WrenForeignMethodFn ScriptingEngine::bind_method(
     WrenVM*, const char*, const char* class_name, bool, const char* sig)
 {
@@ -257,60 +593,99 @@ static void slate_clear_highlight_rules(WrenVM* vm) {
     std::string s(sig);
 
     // ── Existing ──────────────────────────────────────────────────────────
-    if (s == "apiVersion()")           return slate_api_version;
-    if (s == "openFile(_)")            return slate_open_file;
-    if (s == "setStatus(_)")           return slate_set_status;
-    if (s == "closeAll()")             return slate_close_all;
-    if (s == "bufferName()")           return slate_buffer_name;
-    if (s == "getLine(_)")             return slate_get_line;
+    if (s == "apiVersion()")           return guarded<slate_api_version>;
+    if (s == "openFile(_)")            return guarded<slate_open_file>;
+    if (s == "setStatus(_)")           return guarded<slate_set_status>;
+    if (s == "closeAll()")             return guarded<slate_close_all>;
+    if (s == "bufferName()")           return guarded<slate_buffer_name>;
+    if (s == "getLine(_)")             return guarded<slate_get_line>;
 
     // ── Buffer access ──────────────────────────────────────────────────────
-    if (s == "lineCount()")            return slate_line_count;
-    if (s == "setLine(_,_)")           return slate_set_line;
-    if (s == "insertLine(_,_)")        return slate_insert_line;
-    if (s == "deleteLine(_)")          return slate_delete_line;
-    if (s == "getCursor()")            return slate_get_cursor;
-    if (s == "setCursor(_,_)")         return slate_set_cursor;
-    if (s == "getYankRegister()")      return slate_get_yank;
-    if (s == "setYankRegister(_)")     return slate_set_yank;
+    if (s == "lineCount()")            return guarded<slate_line_count>;
+    if (s == "setLine(_,_)")           return guarded<slate_set_line>;
+    if (s == "insertLine(_,_)")        return guarded<slate_insert_line>;
+    if (s == "deleteLine(_)")          return guarded<slate_delete_line>;
+    if (s == "getLines(_,_)")          return guarded<slate_get_lines>;
+    if (s == "setLines(_,_)")          return guarded<slate_set_lines>;
+    if (s == "replaceRange(_,_,_)")    return guarded<slate_replace_range>;
+    if (s == "beginTransaction()")     return guarded<slate_begin_transaction>;
+    if (s == "endTransaction()")       return slate_end_transaction;
+    if (s == "getCursor()")            return guarded<slate_get_cursor>;
+    if (s == "setCursor(_,_)")         return guarded<slate_set_cursor>;
+    if (s == "getYankRegister()")      return guarded<slate_get_yank>;
+    if (s == "setYankRegister(_)")     return guarded<slate_set_yank>;
 
     // ── Editor state ───────────────────────────────────────────────────────
-    if (s == "getMode()")              return slate_get_mode;
-    if (s == "setMode(_)")             return slate_set_mode;
-    if (s == "getSearchQuery()")       return slate_get_search;
-    if (s == "setSearchQuery(_)")      return slate_set_search;
-    if (s == "isModified()")           return slate_is_modified;
-    if (s == "filePath()")             return slate_file_path;
+    if (s == "getMode()")              return guarded<slate_get_mode>;
+    if (s == "setMode(_)")             return guarded<slate_set_mode>;
+    if (s == "getSearchQuery()")       return guarded<slate_get_search>;
+    if (s == "setSearchQuery(_)")      return guarded<slate_set_search>;
+    if (s == "isModified()")           return guarded<slate_is_modified>;
+    if (s == "filePath()")             return guarded<slate_file_path>;
 
     // ── Undo / Redo ────────────────────────────────────────────────────────
-    if (s == "undo()")                 return slate_undo;
-    if (s == "redo()")                 return slate_redo;
-    if (s == "pushUndo()")             return slate_push_undo;
+    if (s == "undo()")                 return guarded<slate_undo>;
+    if (s == "redo()")                 return guarded<slate_redo>;
+    if (s == "pushUndo()")             return guarded<slate_push_undo>;
 
     // ── Actions ────────────────────────────────────────────────────────────
-    if (s == "exec(_)")                return slate_exec;
-    if (s == "saveFile()")             return slate_save_file;
-    if (s == "closeBuffer()")          return slate_close_buffer;
-    if (s == "nextBuffer()")           return slate_next_buffer;
-    if (s == "prevBuffer()")           return slate_prev_buffer;
-    if (s == "newBuffer(_)")           return slate_new_buffer;
+    if (s == "exec(_)")                return guarded<slate_exec>;
+    if (s == "spawn(_,_)")             return guarded<slate_spawn>;
+    if (s == "spawnToBuffer(_,_)")     return guarded<slate_spawn_to_buffer>;
+    if (s == "cancelJob(_)")           return slate_cancel_job;
+    if (s == "setJobLimit(_)")         return guarded<slate_set_job_limit>;
+    if (s == "jobCount()")             return guarded<slate_job_count>;
+
+    // ── Workers ────────────────────────────────────────────────────────────
+    if (s == "spawnWorker(_,_)")       return guarded<slate_spawn_worker>;
+    if (s == "postToWorker(_,_)")      return guarded<slate_post_to_worker>;
+    if (s == "postSnapshotToWorker(_)") return guarded<slate_post_snapshot_to_worker>;
+    if (s == "stopWorker(_)")          return slate_stop_worker;
+
+    // ── Async ──────────────────────────────────────────────────────────────
+    if (s == "wakeAfter_(_,_)")        return guarded<slate_wake_after>;
+    if (s == "awaitJob_(_,_)")         return guarded<slate_await_job>;
+    if (s == "saveFile()")             return guarded<slate_save_file>;
+    if (s == "closeBuffer()")          return guarded<slate_close_buffer>;
+    if (s == "nextBuffer()")           return guarded<slate_next_buffer>;
+    if (s == "prevBuffer()")           return guarded<slate_prev_buffer>;
+    if (s == "newBuffer(_)")           return guarded<slate_new_buffer>;
 
     // ── Keybinds & commands ────────────────────────────────────────────────
-    if (s == "bindCommand(_,_)")       return slate_bind_command;
-    if (s == "bindKey(_,_)")           return slate_bind_key;
-    if (s == "bindInsertKey(_,_)")     return slate_bind_insert_key;
-    if (s == "bindOnChange(_)")        return slate_bind_on_change;
-    if (s == "bindOnSave(_)")          return slate_bind_on_save;
-    if (s == "bindOnOpen(_)")          return slate_bind_on_open;
-    if (s == "bindOnModeChange(_)")    return slate_bind_on_mode_change;
+    if (s == "bindCommand(_,_)")       return guarded<slate_bind_command>;
+    if (s == "bindKey(_,_)")           return guarded<slate_bind_key>;
+    if (s == "bindInsertKey(_,_)")     return guarded<slate_bind_insert_key>;
+    if (s == "bindOnChange(_)")        return guarded<slate_bind_on_change>;
+    if (s == "bindOnChangeDebounced(_,_)") return guarded<slate_bind_on_change_debounced>;
+    if (s == "bindOnSave(_)")          return guarded<slate_bind_on_save>;
+    if (s == "bindOnOpen(_)")          return guarded<slate_bind_on_open>;
+    if (s == "bindOnModeChange(_)")    return guarded<slate_bind_on_mode_change>;
 
     // ── UI ─────────────────────────────────────────────────────────────────
-    if (s == "addStatusSegment(_)")    return slate_add_status_seg;
-    if (s == "showOverlay(_)")         return slate_show_overlay;
+    if (s == "addStatusSegment(_)")    return guarded<slate_add_status_seg>;
+    if (s == "addStatusSegment(_,_)")  return guarded<slate_add_status_seg_on>;
+    if (s == "refreshStatusSegment(_)") return guarded<slate_refresh_status_seg>;
+    if (s == "showOverlay(_)")         return guarded<slate_show_overlay>;
 
     // ── Syntax ─────────────────────────────────────────────────────────────
-    if (s == "addHighlightRule(_,_,_)") return slate_add_highlight_rule;
-    if (s == "clearHighlightRules(_)")  return slate_clear_highlight_rules;
+    if (s == "addHighlightRule(_,_,_)") return guarded<slate_add_highlight_rule>;
+    if (s == "clearHighlightRules(_)")  return guarded<slate_clear_highlight_rules>;
+
+    // ── Memory ─────────────────────────────────────────────────────────────
+    if (s == "memoryUsage()")          return guarded<slate_memory_usage>;
+    if (s == "vmStats()")              return guarded<slate_vm_stats>;
+    if (s == "bufferMemory()")         return guarded<slate_buffer_memory>;
+
+    // ── Folding ────────────────────────────────────────────────────────────
+    if (s == "addFold(_,_)")           return guarded<slate_add_fold>;
+    if (s == "deleteFold(_)")          return guarded<slate_delete_fold>;
+    if (s == "openFold(_)")            return guarded<slate_open_fold>;
+    if (s == "closeFold(_)")           return guarded<slate_close_fold>;
+    if (s == "toggleFold(_)")          return guarded<slate_toggle_fold>;
+    if (s == "openAllFolds()")         return guarded<slate_open_all_folds>;
+    if (s == "closeAllFolds()")        return guarded<slate_close_all_folds>;
+    if (s == "foldAt(_)")              return guarded<slate_fold_at>;
+    if (s == "isLineHidden(_)")        return guarded<slate_is_line_hidden>;
 
     return nullptr;
 }
@@ -319,15 +694,98 @@ static void slate_clear_highlight_rules(WrenVM* vm) {
 //  VM lifecycle
 // ════════════════════════════════════════════════════════════════════════════
 
+static std::atomic<size_t> g_modules_loaded{0}; // files read by load_module
+
+// Wren's reallocate hook is not told the old size, so every block carries a
+// small header holding it. That keeps the live-heap counter exact.
+static std::atomic<size_t> g_wren_heap_bytes{0};
+static std::atomic<size_t> g_wren_heap_peak{0};
+static std::atomic<uint64_t> g_wren_allocs{0}, g_wren_frees{0};
+// Per thread so worker VMs don't inflate the UI thread's callback profile.
+static thread_local uint64_t t_wren_allocated = 0; // cumulative growth
+
+/*static*/ void* ScriptingEngine::reallocate(void* memory, size_t new_size, void*) {
+    constexpr size_t HDR = alignof(std::max_align_t);
+    char*  base     = memory ? (char*)memory - HDR : nullptr;
+    size_t old_size = base ? *(size_t*)base : 0;
+    if (new_size == 0) {
+        std::free(base);
+        if (base) {
+            ++g_wren_frees;
+            if (kAllocStats) alloc_note_delete();
+        }
+        g_wren_heap_bytes -= old_size;
+        return nullptr;
+    }
+    char* p = (char*)std::realloc(base, new_size + HDR);
+    if (!p) return nullptr;
+    *(size_t*)p = new_size;
+    if (!base) ++g_wren_allocs;
+    // The per-phase counts see Wren's heap as operator new would: a new
+    // block, or growth as a fresh block replacing the old one.
+    if (kAllocStats && new_size > old_size) {
+        alloc_note_new(new_size);
+        if (base) alloc_note_delete();
+    }
+    if (new_size > old_size) t_wren_allocated += new_size - old_size;
+    size_t now = (g_wren_heap_bytes += new_size - old_size);
+    size_t peak = g_wren_heap_peak.load();
+    while (now > peak && !g_wren_heap_peak.compare_exchange_weak(peak, now)) {}
+    return p + HDR;
+}
+
+/*static*/ size_t ScriptingEngine::heap_bytes() { return g_wren_heap_bytes.load(); }
+
+ScriptingEngine::VmStats ScriptingEngine::vm_stats() const {
+    VmStats st;
+    st.heap_bytes   = heap_bytes();
+    st.heap_peak    = heap_peak();
+    st.allocs       = g_wren_allocs.load();
+    st.frees        = g_wren_frees.load();
+    st.live_handles = g_live_handles;
+    st.gc_runs      = gc_runs_;
+    st.gc_last_ms   = gc_last_ms_;
+    return st;
+}
+
+double ScriptingEngine::collect_garbage() {
+    TraceScope trace_scope("ScriptingEngine::collect_garbage");
+    auto t0 = std::chrono::steady_clock::now();
+    wrenCollectGarbage(vm_);
+    gc_last_ms_ = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - t0).count();
+    ++gc_runs_;
+    return gc_last_ms_;
+}
+
+void ScriptingEngine::release(WrenHandle* h) {
+    if (!h) return;
+    --g_live_handles;
+    wrenReleaseHandle(vm_, h);
+}
+
+void ScriptingEngine::release(WrenCallback& cb) {
+    if (cb.receiver) callback_profiler().forget(cb.receiver);
+    release(cb.receiver);
+    release(cb.method);
+    cb = {};
+}
+/*static*/ size_t ScriptingEngine::heap_peak()  { return g_wren_heap_peak.load(); }
+
 /*static*/ void ScriptingEngine::write(WrenVM*, const char* text) {
     std::cerr << text;
 }
 
+static thread_local uint64_t t_script_errors = 0;
+
+/*static*/ uint64_t ScriptingEngine::error_count() { return t_script_errors; }
+
 /*static*/ void ScriptingEngine::error_handler(WrenVM* vm, WrenErrorType type,
     const char* module, int line, const char* msg)
 {
     VedApp* app = (VedApp*)wrenGetUserData(vm);
     std::string err;
+    if (type != WREN_ERROR_STACK_TRACE) ++t_script_errors;
     if (type == WREN_ERROR_COMPILE)
         err = std::string(module) + ":" + std::to_string(line) + ": " + msg;
     else if (type == WREN_ERROR_RUNTIME)
@@ -338,20 +796,91 @@ static void slate_clear_highlight_rules(WrenVM* vm) {
     std::cerr << err << '\n';
 }
 
+// ── Module loader ────────────────────────────────────────────────────────────
+// Imports resolve to canonical file paths, so Wren's module registry compiles
+// a shared module once however many plugins import it. "./x" and "../x" are
+// relative to the importing file; bare names come from <config>/modules.
+
+static char* wren_strdup(const std::string& s) {
+    char* p = (char*)ScriptingEngine::reallocate(nullptr, s.size() + 1, nullptr);
+    std::memcpy(p, s.c_str(), s.size() + 1);
+    return p;
+}
+
+std::string resolve_module_name(const std::string& importer, const std::string& name,
+                                const std::string& modules_dir) {
+    bool relative = name.rfind("./", 0) == 0 || name.rfind("../", 0) == 0;
+    fs::path p = relative ? fs::path(importer).parent_path() / name
+                          : fs::path(modules_dir) / name;
+    p += ".wren";
+    // Unknown bare names stay as-is so built-in and optional modules (slate,
+    // meta, random) still resolve.
+    if (!relative && !fs::exists(p)) return name;
+    std::error_code ec;
+    auto canon = fs::weakly_canonical(p, ec);
+    return (ec ? p : canon).string();
+}
+
+/*static*/ const char* ScriptingEngine::resolve_module(WrenVM* vm, const char* importer,
+                                                       const char* name) {
+    auto* app = (VedApp*)wrenGetUserData(vm);
+    return wren_strdup(resolve_module_name(importer, name, app->config_dir() + "/modules"));
+}
+
+static void free_module_source(WrenVM*, const char*, WrenLoadModuleResult r) {
+    delete[] r.source;
+}
+
+/*static*/ WrenLoadModuleResult ScriptingEngine::load_module(WrenVM*, const char* name) {
+    WrenLoadModuleResult r{};
+    std::ifstream f(name);
+    if (!f.is_open()) return r; // Wren reports "Could not load module"
+    std::ostringstream ss; ss << f.rdbuf();
+    std::string src = ss.str();
+    char* buf = new char[src.size() + 1];
+    std::memcpy(buf, src.c_str(), src.size() + 1);
+    r.source     = buf;
+    r.onComplete = free_module_source;
+    ++g_modules_loaded;
+    return r;
+}
+
 ScriptingEngine::ScriptingEngine(VedApp& app) : app_(app) { init_vm(); }
-ScriptingEngine::~ScriptingEngine() { if (vm_) wrenFreeVM(vm_); }
+ScriptingEngine::~ScriptingEngine() {
+    if (!vm_) return;
+    if (slate_class_)   wrenReleaseHandle(vm_, slate_class_);
+    if (resume_method_) wrenReleaseHandle(vm_, resume_method_);
+    if (call_fn_)       wrenReleaseHandle(vm_, call_fn_);
+    for (auto& [path, fn] : batch_fns_) wrenReleaseHandle(vm_, fn);
+    wrenFreeVM(vm_);
+}
 
 void ScriptingEngine::init_vm() {
     WrenConfiguration cfg;
     wrenInitConfiguration(&cfg);
+    cfg.reallocateFn        = &ScriptingEngine::reallocate;
     cfg.writeFn             = &ScriptingEngine::write;
     cfg.errorFn             = &ScriptingEngine::error_handler;
     cfg.bindForeignMethodFn = &ScriptingEngine::bind_method;
+    cfg.resolveModuleFn     = &ScriptingEngine::resolve_module;
+    cfg.loadModuleFn        = &ScriptingEngine::load_module;
     cfg.userData            = &app_;
     vm_ = wrenNewVM(&cfg);
 
     // ── Wren bootstrap ────────────────────────────────────────────────────
     const char* bootstrap = R"(
+// A fiber started by Slate.async and resumed by the host from the UI loop.
+class Task {
+    construct new_(fn) {
+        _fiber = Fiber.new { fn.call() }
+        _cancelled = false
+    }
+    fiber { _fiber }
+    cancel() { _cancelled = true }
+    isCancelled { _cancelled }
+    isDone { _fiber.isDone }
+}
+
 class Slate {
     // meta
     foreign static apiVersion()
@@ -367,6 +896,23 @@ class Slate {
     foreign static getYankRegister()
     foreign static setYankRegister(str)
 
+    // batched buffer access; ranges are half-open (end line excluded)
+    foreign static getLines(start, end)
+    foreign static setLines(start, lines)
+    foreign static replaceRange(start, end, lines)
+
+    // edits made inside fn fire one change event and form one undo step
+    foreign static beginTransaction()
+    foreign static endTransaction()
+    static transaction(fn) {
+        beginTransaction()
+        var fiber = Fiber.new { fn.call() }
+        var result = fiber.try()
+        endTransaction()
+        if (fiber.error != null) Fiber.abort(fiber.error)
+        return result
+    }
+
     // editor state
     foreign static getMode()
     foreign static setMode(str)
@@ -381,7 +927,7 @@ class Slate {
     foreign static redo()
     foreign static pushUndo()
 
-    // actions
+    // actions (exec blocks the editor, up to 2 s; prefer spawn)
     foreign static exec(cmd)
     foreign static openFile(path)
     foreign static saveFile()
@@ -391,34 +937,182 @@ class Slate {
     foreign static prevBuffer()
     foreign static newBuffer(name)
 
+    // jobs: fn(kind, data) gets ("stdout"|"stderr", chunk) then ("exit", code: Num)
+    foreign static spawn(cmd, fn)
+    foreign static spawnToBuffer(cmd, bufferName)
+    foreign static cancelJob(id)
+    foreign static setJobLimit(n)
+    foreign static jobCount()
+
+    // workers: the script at path (absolute, or under ~/.config/slate) runs
+    // in its own VM on a thread pool and talks through Worker.onMessage and
+    // Worker.post; fn(msg) gets each post. Messages are null, Bool, Num,
+    // String or List; a snapshot of the buffer arrives as a List of lines.
+    // stopWorker drops pending mail but only takes effect between messages:
+    // a handler already running finishes first
+    foreign static spawnWorker(path, fn)
+    foreign static postToWorker(id, msg)
+    foreign static postSnapshotToWorker(id)
+    foreign static stopWorker(id)
+
+    // async: code in Slate.async may sleep, yield and await jobs; each
+    // suspension hands control back to the editor until the host resumes it
+    foreign static wakeAfter_(task, ms)
+    foreign static awaitJob_(task, cmd)
+    static async(fn) {
+        var task = Task.new_(fn)
+        wakeAfter_(task, 0)
+        return task
+    }
+    static sleep(ms) {
+        checkAsync_("sleep")
+        wakeAfter_(__current, ms)
+        return Fiber.suspend()
+    }
+    static yield() { sleep(0) }
+    // Map with code, stdout and stderr once cmd exits
+    static run(cmd) {
+        checkAsync_("run")
+        awaitJob_(__current, cmd)
+        return Fiber.suspend()
+    }
+    // fn every ms until the returned Task is cancelled
+    static every(ms, fn) {
+        return async {
+            while (true) {
+                sleep(ms)
+                fn.call()
+            }
+        }
+    }
+    static checkAsync_(what) {
+        if (__current == null || __current.fiber != Fiber.current) {
+            Fiber.abort("Slate.%(what) must be called inside Slate.async")
+        }
+    }
+    static resume_(task, value) {
+        if (task.isCancelled || task.isDone) return
+        __current = task
+        task.fiber.transfer(value)
+    }
+
     // keybinds & commands
     foreign static bindCommand(name, fn)
     foreign static bindKey(key, fn)
     foreign static bindInsertKey(key, fn)
     foreign static bindOnChange(fn)
+    // fn(ranges) after delayMs without edits; ranges is a List of Maps with
+    // start, removed and inserted line counts, merged over the burst
+    foreign static bindOnChangeDebounced(delayMs, fn)
     foreign static bindOnSave(fn)
     foreign static bindOnOpen(fn)
     foreign static bindOnModeChange(fn)
 
     // UI
     foreign static setStatus(msg)
+    // segments cache fn's text; it is re-run only on its refresh triggers:
+    // "change save mode open cursor every:<ms> manual" (any subset; open
+    // also covers switching buffers). The one-argument form uses
+    // "change save mode open"; ask for "cursor" to re-run on every motion
     foreign static addStatusSegment(fn)
+    foreign static addStatusSegment(refresh, fn)
+    foreign static refreshStatusSegment(id)
     foreign static showOverlay(str)
 
     // syntax
     foreign static addHighlightRule(ext, pattern, tokenType)
     foreign static clearHighlightRules(ext)
+
+    // memory (Maps of byte counts: text, undo, redo, caches, wrenHeap, total)
+    foreign static memoryUsage()
+    foreign static bufferMemory()
+    // heapBytes, heapPeak, allocs, frees, liveHandles, gcRuns, gcLastMs
+    foreign static vmStats()
+
+    // folding (rows are 0-based; foldAt returns "start:end" or "")
+    foreign static addFold(start, end)
+    foreign static deleteFold(row)
+    foreign static openFold(row)
+    foreign static closeFold(row)
+    foreign static toggleFold(row)
+    foreign static openAllFolds()
+    foreign static closeAllFolds()
+    foreign static foldAt(row)
+    foreign static isLineHidden(row)
 }
 )";
     wrenInterpret(vm_, "slate", bootstrap);
+
+    wrenEnsureSlots(vm_, 1);
+    wrenGetVariable(vm_, "slate", "Slate", 0);
+    slate_class_   = wrenGetSlotHandle(vm_, 0);
+    resume_method_ = wrenMakeCallHandle(vm_, "resume_(_,_)");
+    callback_profiler().tag(resume_method_, "Slate.async tasks", "*");
 }
 
 // ════════════════════════════════════════════════════════════════════════════
 //  Call helpers
 // ════════════════════════════════════════════════════════════════════════════
 
+// Charges one callback run to its CallbackProfiler entry, and makes its plugin
+// the owner meanwhile so bindings it creates are attributed correctly. The
+// outermost call also arms the watchdog deadline; overrunning it is a strike,
+// and a callback that collects enough strikes is disabled.
+class ProfiledCall {
+public:
+    ProfiledCall(VedApp& app, const void* key, bool can_disable = true)
+        : app_(app), key_(key), can_disable_(can_disable),
+          prev_owner_(callback_profiler().owner()),
+          bytes0_(t_wren_allocated), txns0_(app.open_transactions()),
+          t0_(std::chrono::steady_clock::now()) {
+        auto& prof = callback_profiler();
+        if (auto* s = prof.find(key)) prof.set_owner(s->owner);
+        if (g_call_depth++ == 0) {
+            g_deadline = t0_ + std::chrono::microseconds((int64_t)(prof.watchdog_ms() * 1000));
+            g_aborted  = false;
+        }
+    }
+    ~ProfiledCall() {
+        auto ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - t0_).count();
+        auto& prof = callback_profiler();
+        prof.set_owner(prev_owner_);
+        bool outermost = --g_call_depth == 0;
+        bool overran = outermost && prof.watchdog_ms() > 0 &&
+                       (g_aborted || ns > prof.watchdog_ms() * 1e6);
+        // An abort can land between beginTransaction and endTransaction.
+        if (outermost && g_aborted) app_.unwind_transactions(txns0_);
+        bool slow = prof.record(key_, ns, t_wren_allocated - bytes0_);
+        auto* s = prof.find(key_);
+        char msg[192];
+        if (overran && can_disable_ && prof.strike(key_)) {
+            std::snprintf(msg, sizeof(msg), "disabled %s: %s after %d overruns (:profile reset)",
+                          s->owner.c_str(), s->kind.c_str(), s->strikes);
+            app_.set_status(msg);
+        } else if (slow) {
+            std::snprintf(msg, sizeof(msg), "slow callback: %s: %s took %.1f ms (budget %.1f)",
+                          s->owner.c_str(), s->kind.c_str(), ns / 1e6, prof.budget_ms());
+            app_.set_status(msg);
+        }
+    }
+    ProfiledCall(const ProfiledCall&) = delete;
+    ProfiledCall& operator=(const ProfiledCall&) = delete;
+
+private:
+    VedApp&      app_;
+    const void*  key_;
+    bool         can_disable_;
+    std::string  prev_owner_;
+    uint64_t     bytes0_;
+    size_t       txns0_;
+    std::chrono::steady_clock::time_point t0_;
+};
+
 void ScriptingEngine::call(WrenCallback& cb, const std::string& arg) {
-    if (!cb.valid()) return;
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return;
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call");
+    ProfiledCall profiled(app_, cb.receiver);
     wrenEnsureSlots(vm_, 2);
     wrenSetSlotHandle(vm_, 0, cb.receiver);
     wrenSetSlotString(vm_, 1, arg.c_str());
@@ -426,7 +1120,10 @@ void ScriptingEngine::call(WrenCallback& cb, const std::string& arg) {
 }
 
 void ScriptingEngine::call0(WrenCallback& cb) {
-    if (!cb.valid()) return;
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return;
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call0");
+    ProfiledCall profiled(app_, cb.receiver);
     wrenEnsureSlots(vm_, 1);
     wrenSetSlotHandle(vm_, 0, cb.receiver);
     wrenCall(vm_, cb.method);
@@ -434,7 +1131,10 @@ void ScriptingEngine::call0(WrenCallback& cb) {
 
 void ScriptingEngine::call2(WrenCallback& cb,
                             const std::string& a, const std::string& b) {
-    if (!cb.valid()) return;
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return;
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call2");
+    ProfiledCall profiled(app_, cb.receiver);
     wrenEnsureSlots(vm_, 3);
     wrenSetSlotHandle(vm_, 0, cb.receiver);
     wrenSetSlotString(vm_, 1, a.c_str());
@@ -442,8 +1142,23 @@ void ScriptingEngine::call2(WrenCallback& cb,
     wrenCall(vm_, cb.method);
 }
 
+void ScriptingEngine::call2(WrenCallback& cb, const std::string& a, double n) {
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return;
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call2");
+    ProfiledCall profiled(app_, cb.receiver);
+    wrenEnsureSlots(vm_, 3);
+    wrenSetSlotHandle(vm_, 0, cb.receiver);
+    wrenSetSlotString(vm_, 1, a.c_str());
+    wrenSetSlotDouble(vm_, 2, n);
+    wrenCall(vm_, cb.method);
+}
+
 std::string ScriptingEngine::call_str(WrenCallback& cb) {
-    if (!cb.valid()) return "";
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return "";
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call_str");
+    ProfiledCall profiled(app_, cb.receiver);
     wrenEnsureSlots(vm_, 1);
     wrenSetSlotHandle(vm_, 0, cb.receiver);
     wrenCall(vm_, cb.method);
@@ -452,25 +1167,210 @@ std::string ScriptingEngine::call_str(WrenCallback& cb) {
     return "";
 }
 
+void ScriptingEngine::call_changes(WrenCallback& cb,
+                                   const std::vector<BufferChange>& changes) {
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return;
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call_changes");
+    ProfiledCall profiled(app_, cb.receiver);
+    wrenEnsureSlots(vm_, 5);
+    wrenSetSlotHandle(vm_, 0, cb.receiver);
+    wrenSetSlotNewList(vm_, 1);
+    auto put = [this](const char* key, int v) {
+        wrenSetSlotString(vm_, 3, key);
+        wrenSetSlotDouble(vm_, 4, (double)v);
+        wrenSetMapValue(vm_, 2, 3, 4);
+    };
+    for (auto& c : changes) {
+        wrenSetSlotNewMap(vm_, 2);
+        put("start", c.start);
+        put("removed", c.removed);
+        put("inserted", c.inserted);
+        wrenInsertInList(vm_, 1, -1, 2);
+    }
+    wrenCall(vm_, cb.method);
+}
+
+void ScriptingEngine::call_msg(WrenCallback& cb, const WorkerMsg& msg) {
+    if (!cb.valid() || callback_profiler().disabled(cb.receiver)) return;
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::call_msg");
+    ProfiledCall profiled(app_, cb.receiver);
+    wrenEnsureSlots(vm_, 2);
+    wrenSetSlotHandle(vm_, 0, cb.receiver);
+    write_worker_msg(vm_, 1, msg);
+    wrenCall(vm_, cb.method);
+}
+
+// Runs the task until it next suspends or finishes, then drops the handle
+// (every wake hands the host a fresh one).
+void ScriptingEngine::resume_task(WrenHandle* task, const SlotWriter& value,
+                                  const std::string& owner) {
+    PerfScope perf_scope(PerfPhase::Script);
+    TraceScope trace_scope("ScriptingEngine::resume_task");
+    ProfiledCall profiled(app_, resume_method_, false); // shared by every task
+    if (!owner.empty()) callback_profiler().set_owner(owner); // until ~profiled
+    wrenEnsureSlots(vm_, 3);
+    wrenSetSlotHandle(vm_, 0, slate_class_);
+    wrenSetSlotHandle(vm_, 1, task);
+    if (value) value(vm_, 2);
+    else       wrenSetSlotNull(vm_, 2);
+    wrenCall(vm_, resume_method_);
+    release(task);
+}
+
 // ════════════════════════════════════════════════════════════════════════════
 //  File loading
 // ════════════════════════════════════════════════════════════════════════════
 
-void ScriptingEngine::load_file(const std::string& path) {
+bool ScriptingEngine::load_file(const std::string& path) {
+    TraceScope trace_scope("ScriptingEngine::load_file");
     std::ifstream f(path);
-    if (!f.is_open()) { app_.set_status("script not found: " + path); return; }
+    if (!f.is_open()) { app_.set_status("script not found: " + path); return false; }
     std::ostringstream ss; ss << f.rdbuf();
-    if (wrenInterpret(vm_, path.c_str(), ss.str().c_str()) != WREN_RESULT_SUCCESS)
+    // A module's top-level names can't be redefined, so a reload runs the
+    // script as a new module ("path@2", ...). Relative imports still work.
+    int n = ++load_counts_[path];
+    std::string module = n == 1 ? path : path + "@" + std::to_string(n);
+    if (wrenInterpret(vm_, module.c_str(), ss.str().c_str()) != WREN_RESULT_SUCCESS) {
         app_.set_status("script error: " + path);
+        return false;
+    }
+    return true;
+}
+
+bool ScriptingEngine::run_as(const std::string& owner, const std::string& path) {
+    app_.drop_bindings(owner);
+    auto& prof = callback_profiler();
+    std::string prev = prof.owner();
+    prof.set_owner(owner);
+    bool ok = load_file(path);
+    prof.set_owner(prev);
+    return ok;
+}
+
+bool ScriptingEngine::reload(const std::string& owner) {
+    TraceScope trace_scope("ScriptingEngine::reload");
+    if (owner == "init") {
+        run_as("init", app_.config_dir() + "/init.wren");
+        return true;
+    }
+    for (auto& p : plugins_)
+        if (p.name == owner) {
+            p.loaded = true;
+            run_as(p.name, p.main);
+            return true;
+        }
+    return false;
+}
+
+bool ScriptingEngine::source(const std::string& path) { return run_as(path, path); }
+
+// The script is wrapped as `var step_ = Fn.new {...}` in its own module, so
+// its top level is a function body (classes belong in imported modules) and
+// error lines are one past the file's.
+bool ScriptingEngine::run_batch_script(const std::string& path) {
+    TraceScope trace_scope("ScriptingEngine::run_batch_script");
+    auto it = batch_fns_.find(path);
+    if (it == batch_fns_.end()) {
+        std::ifstream f(path);
+        if (!f.is_open()) { app_.set_status("script not found: " + path); return false; }
+        std::ostringstream ss;
+        ss << "var step_ = Fn.new {\n" << f.rdbuf() << "\n}\n";
+        std::string module = path + "#batch"; // relative imports still resolve
+        if (wrenInterpret(vm_, module.c_str(), ss.str().c_str()) != WREN_RESULT_SUCCESS) {
+            app_.set_status("script error: " + path);
+            return false;
+        }
+        wrenEnsureSlots(vm_, 1);
+        wrenGetVariable(vm_, module.c_str(), "step_", 0);
+        it = batch_fns_.emplace(path, wrenGetSlotHandle(vm_, 0)).first;
+        if (!call_fn_) call_fn_ = wrenMakeCallHandle(vm_, "call()");
+    }
+    app_.drop_bindings(path);
+    auto& prof = callback_profiler();
+    std::string prev = prof.owner();
+    prof.set_owner(path);
+    wrenEnsureSlots(vm_, 1);
+    wrenSetSlotHandle(vm_, 0, it->second);
+    bool ok = wrenCall(vm_, call_fn_) == WREN_RESULT_SUCCESS;
+    prof.set_owner(prev);
+    if (!ok) app_.set_status("script error: " + path);
+    return ok;
+}
+
+// ── Plugins ──────────────────────────────────────────────────────────────────
+// A plugin is plugins/<name>/main.wren. An optional plugins/<name>/manifest
+// defers loading until the first use of one of its triggers:
+//
+//   command fmt     # :fmt
+//   key Q           # normal-mode key
+//   ext .py         # a file with this extension is opened
+//   startup         # load eagerly anyway
+//
+// Plugins without a manifest, or with no triggers, load at startup.
+
+static bool read_manifest(const fs::path& path, ScriptingEngine::Plugin& p,
+                          std::string& err) {
+    std::ifstream f(path);
+    std::string line;
+    for (int n = 1; std::getline(f, line); ++n) {
+        std::istringstream ls(line);
+        std::string kind, arg;
+        ls >> kind >> arg;
+        if (kind.empty() || kind[0] == '#') continue;
+        if (kind == "startup") p.startup = true;
+        else if (kind == "command" && !arg.empty()) p.commands.push_back(arg);
+        else if (kind == "key" && !arg.empty())     p.keys.push_back(arg);
+        else if (kind == "ext" && !arg.empty())     p.exts.push_back(arg);
+        else {
+            err = path.string() + ":" + std::to_string(n) + ": bad trigger";
+            return false;
+        }
+    }
+    return true;
 }
 
 void ScriptingEngine::load_plugins_dir(const std::string& dir) {
     if (!fs::exists(dir)) return;
-    for (auto& entry : fs::directory_iterator(dir)) {
-        if (!entry.is_directory()) continue;
-        auto main = entry.path() / "main.wren";
-        if (fs::exists(main)) load_file(main.string());
+    std::vector<fs::path> dirs;
+    for (auto& entry : fs::directory_iterator(dir))
+        if (entry.is_directory()) dirs.push_back(entry.path());
+    std::sort(dirs.begin(), dirs.end()); // load order independent of the fs
+
+    for (auto& d : dirs) {
+        auto main = d / "main.wren";
+        if (!fs::exists(main)) continue;
+        Plugin p;
+        p.name = d.filename().string();
+        p.main = main.string();
+        std::string err;
+        if (fs::exists(d / "manifest") && !read_manifest(d / "manifest", p, err)) {
+            error(err);
+            p.startup = true;
+        }
+        size_t idx = plugins_.size();
+        plugins_.push_back(std::move(p));
+        Plugin& q = plugins_.back();
+        if (q.startup || !q.lazy()) {
+            activate(idx);
+            continue;
+        }
+        auto act = [this, idx] { activate(idx); };
+        for (auto& c : q.commands) app_.add_command_trigger(c, act);
+        for (auto& k : q.keys)     app_.add_key_trigger(k, act);
+        for (auto& e : q.exts)     app_.add_ext_trigger(e, act);
     }
 }
 
+void ScriptingEngine::activate(size_t idx) {
+    Plugin& p = plugins_[idx];
+    if (p.loaded) return;
+    p.loaded = true;
+    TraceScope trace_scope("ScriptingEngine::activate");
+    run_as(p.name, p.main);
+}
+
+size_t ScriptingEngine::modules_loaded() { return g_modules_loaded; }
+
 void ScriptingEngine::error(const std::string& msg) { app_.set_status(msg); }
@@ -0,0 +1,51 @@
+// timer.cpp — deadline-ordered callback thread
+#include "timer.h"
+
+TimerQueue::~TimerQueue() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+uint64_t TimerQueue::schedule(Clock::duration delay, std::function<void()> fn) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!thread_.joinable()) thread_ = std::thread([this] { run(); });
+    uint64_t id = next_id_++;
+    auto due = Clock::now() + delay;
+    queue_.emplace(Key{due, id}, std::move(fn));
+    due_[id] = due;
+    cv_.notify_all();
+    return id;
+}
+
+void TimerQueue::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = due_.find(id);
+    if (it == due_.end()) return;
+    queue_.erase(Key{it->second, id});
+    due_.erase(it);
+}
+
+void TimerQueue::run() {
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!stop_) {
+        if (queue_.empty()) {
+            cv_.wait(lk);
+            continue;
+        }
+        auto first = queue_.begin();
+        if (Clock::now() < first->first.first) {
+            cv_.wait_until(lk, first->first.first);
+            continue;
+        }
+        auto fn = std::move(first->second);
+        due_.erase(first->first.second);
+        queue_.erase(first);
+        lk.unlock();
+        fn();
+        lk.lock();
+    }
+}
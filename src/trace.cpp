@@ -0,0 +1,129 @@
+// trace.cpp — per-thread trace rings + Chrome trace JSON writer
+#include "trace.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_trace_enabled{false};
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t    begin_ns;
+    uint64_t    end_ns;
+};
+
+// Single producer (the owning thread), read by trace_stop. Overwrites the
+// oldest events when full; 'head' counts every event ever written.
+struct TraceRing {
+    static constexpr size_t CAP = 1 << 16;
+    std::vector<TraceEvent> events = std::vector<TraceEvent>(CAP);
+    std::atomic<uint64_t>   head{0};
+    int                     tid = 0;
+};
+
+std::mutex                              g_rings_mu;
+std::vector<std::shared_ptr<TraceRing>> g_rings;      // rings outlive their threads
+std::vector<TraceRing*>                 g_free_rings; // ...and go to the next one
+std::atomic<uint64_t>                   g_epoch_ns{0};
+
+// A thread's claim on a ring, handed back when the thread exits, so threads
+// that come and go (a fold scan per opened file) share rings instead of
+// each leaving one behind. A reused ring keeps its tid and older events.
+struct RingLease {
+    TraceRing* ring = nullptr;
+    ~RingLease() {
+        if (!ring) return;
+        std::lock_guard<std::mutex> lk(g_rings_mu);
+        g_free_rings.push_back(ring);
+    }
+};
+
+TraceRing& local_ring() {
+    thread_local RingLease lease;
+    if (!lease.ring) {
+        std::lock_guard<std::mutex> lk(g_rings_mu);
+        if (!g_free_rings.empty()) {
+            lease.ring = g_free_rings.back();
+            g_free_rings.pop_back();
+        } else {
+            auto r = std::make_shared<TraceRing>();
+            r->tid = (int)g_rings.size() + 1;
+            g_rings.push_back(r);
+            lease.ring = r.get();
+        }
+    }
+    return *lease.ring;
+}
+
+void write_name(std::ofstream& f, const char* s) {
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') f << '\\';
+        f << *s;
+    }
+}
+
+} // namespace
+
+uint64_t trace_now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace_record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+    auto& ring = local_ring();
+    uint64_t h = ring.head.load(std::memory_order_relaxed);
+    ring.events[h % TraceRing::CAP] = {name, begin_ns, end_ns};
+    ring.head.store(h + 1, std::memory_order_release);
+}
+
+void trace_start() {
+    {
+        std::lock_guard<std::mutex> lk(g_rings_mu);
+        for (auto& r : g_rings) r->head.store(0, std::memory_order_relaxed);
+    }
+    g_epoch_ns.store(trace_now_ns());
+    g_trace_enabled.store(true, std::memory_order_release);
+}
+
+bool trace_stop(const std::string& path) {
+    g_trace_enabled.store(false, std::memory_order_release);
+    std::ofstream f(path);
+    if (!f.is_open()) return false;
+
+    uint64_t epoch = g_epoch_ns.load();
+    f << std::fixed;
+    f.precision(3);
+    f << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    bool first = true;
+    std::vector<TraceEvent> snap;
+    std::lock_guard<std::mutex> lk(g_rings_mu);
+    for (auto& r : g_rings) {
+        // Scopes opened before the stop still record, overwriting the oldest
+        // slots. Copy up to the head seen here, then keep only copies that
+        // no write since (or in progress, at index 'now') can have touched.
+        uint64_t head = r->head.load(std::memory_order_acquire);
+        uint64_t from = head > TraceRing::CAP ? head - TraceRing::CAP : 0;
+        snap.clear();
+        for (uint64_t i = from; i < head; ++i)
+            snap.push_back(r->events[i % TraceRing::CAP]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = r->head.load(std::memory_order_relaxed);
+        uint64_t valid = now >= TraceRing::CAP ? now - TraceRing::CAP + 1 : 0;
+        for (uint64_t i = std::max(from, valid); i < head; ++i) {
+            const auto& e = snap[i - from];
+            if (e.begin_ns < epoch) continue;
+            f << (first ? "" : ",\n") << "{\"name\": \"";
+            write_name(f, e.name);
+            f << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << r->tid
+              << ", \"ts\": " << (e.begin_ns - epoch) / 1000.0
+              << ", \"dur\": " << (e.end_ns - e.begin_ns) / 1000.0 << "}";
+            first = false;
+        }
+    }
+    f << "\n]}\n";
+    return (bool)f;
+}
@@ -0,0 +1,351 @@
+// worker.cpp — Wren worker VMs on a thread pool, with message passing
+#include "worker.h"
+#include "scripting.h"
+#include "trace.h"
+#include <wren.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// ── Messages ─────────────────────────────────────────────────────────────────
+
+bool read_worker_msg(WrenVM* vm, int slot, WorkerMsg& out, std::string& err) {
+    switch (wrenGetSlotType(vm, slot)) {
+    case WREN_TYPE_NULL:
+        out.kind = WorkerMsg::Null;
+        return true;
+    case WREN_TYPE_BOOL:
+        out.kind = WorkerMsg::Bool;
+        out.num  = wrenGetSlotBool(vm, slot) ? 1 : 0;
+        return true;
+    case WREN_TYPE_NUM:
+        out.kind = WorkerMsg::Num;
+        out.num  = wrenGetSlotDouble(vm, slot);
+        return true;
+    case WREN_TYPE_STRING: {
+        int len = 0;
+        const char* s = wrenGetSlotBytes(vm, slot, &len);
+        out.kind = WorkerMsg::Str;
+        out.str.assign(s, len);
+        return true;
+    }
+    case WREN_TYPE_LIST: {
+        int n = wrenGetListCount(vm, slot);
+        wrenEnsureSlots(vm, slot + 2);
+        out.kind = WorkerMsg::List;
+        out.list.resize(n);
+        for (int i = 0; i < n; ++i) {
+            wrenGetListElement(vm, slot, i, slot + 1);
+            if (!read_worker_msg(vm, slot + 1, out.list[i], err)) return false;
+        }
+        return true;
+    }
+    default:
+        err = "worker messages must be null, Bool, Num, String or List";
+        return false;
+    }
+}
+
+void write_worker_msg(WrenVM* vm, int slot, const WorkerMsg& m) {
+    wrenEnsureSlots(vm, slot + 2);
+    switch (m.kind) {
+    case WorkerMsg::Null: wrenSetSlotNull(vm, slot); break;
+    case WorkerMsg::Bool: wrenSetSlotBool(vm, slot, m.num != 0); break;
+    case WorkerMsg::Num:  wrenSetSlotDouble(vm, slot, m.num); break;
+    case WorkerMsg::Str:  wrenSetSlotBytes(vm, slot, m.str.data(), m.str.size()); break;
+    case WorkerMsg::List:
+        wrenSetSlotNewList(vm, slot);
+        for (auto& e : m.list) {
+            write_worker_msg(vm, slot + 1, e);
+            wrenInsertInList(vm, slot, -1, slot + 1);
+        }
+        break;
+    case WorkerMsg::Lines:
+        wrenSetSlotNewList(vm, slot);
+        if (m.lines)
+            for (auto& l : *m.lines) {
+                wrenSetSlotBytes(vm, slot + 1, l.data(), l.size());
+                wrenInsertInList(vm, slot, -1, slot + 1);
+            }
+        break;
+    }
+}
+
+// ── Worker VM ────────────────────────────────────────────────────────────────
+
+static const char* kWorkerBootstrap = R"(
+class Worker {
+    // send msg to the editor (null, Bool, Num, String or List)
+    foreign static post(msg)
+    static onMessage(fn) { __onMessage = fn }
+    static dispatch_(msg) {
+        if (__onMessage != null) __onMessage.call(msg)
+    }
+}
+)";
+
+// ── Shared pool state ────────────────────────────────────────────────────────
+
+struct WorkerPool::Shared {
+    Post                                    post_;
+    WorkerHandlers                          handlers_;
+    mutable std::mutex                      mu_;
+    std::condition_variable                 cv_;
+    std::deque<std::shared_ptr<Worker>>     ready_;
+    std::map<int, std::shared_ptr<Worker>>  workers_;
+    int                                     next_id_ = 1;
+    int                                     busy_ = 0; // threads inside a slice
+    bool                                    quit_ = false;
+
+    // Hands fn to the UI loop unless the pool (and maybe the editor) is gone.
+    void post(std::function<void()> fn) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!quit_) post_(std::move(fn));
+    }
+};
+
+struct WorkerPool::Worker {
+    int         id = 0;
+    std::string path, modules_dir;
+    Shared*     pool = nullptr; // alive while a thread runs this worker
+
+    // Touched only by the thread running the current slice.
+    WrenVM*     vm = nullptr;
+    WrenHandle* cls = nullptr;
+    WrenHandle* dispatch = nullptr;
+    bool        started = false;
+    std::string err; // runtime/compile errors of the current call
+
+    // Guarded by pool->mu_.
+    std::deque<WorkerMsg> inbox;
+    bool queued  = false; // in ready_ or running
+    bool stopped = false;
+
+    ~Worker() {
+        if (!vm) return;
+        if (cls)      wrenReleaseHandle(vm, cls);
+        if (dispatch) wrenReleaseHandle(vm, dispatch);
+        wrenFreeVM(vm);
+    }
+
+    bool boot();
+    bool deliver(const WorkerMsg& msg);
+    void report();
+
+    static void post(WrenVM* vm); // Worker.post(_)
+    static WrenForeignMethodFn bind(WrenVM*, const char* module, const char* cls,
+                                    bool is_static, const char* sig);
+    static const char* resolve(WrenVM* vm, const char* importer, const char* name);
+    static void write(WrenVM*, const char* text) { std::cerr << text; }
+    static void error(WrenVM* vm, WrenErrorType type, const char* module, int line,
+                      const char* msg);
+};
+
+void WorkerPool::Worker::post(WrenVM* vm) {
+    auto* w = (Worker*)wrenGetUserData(vm);
+    WorkerMsg msg;
+    std::string err;
+    if (!read_worker_msg(vm, 1, msg, err)) {
+        wrenSetSlotString(vm, 0, err.c_str());
+        wrenAbortFiber(vm, 0);
+        return;
+    }
+    w->pool->post([h = w->pool->handlers_.on_message, id = w->id, m = std::move(msg)] {
+        if (h) h(id, m);
+    });
+}
+
+WrenForeignMethodFn WorkerPool::Worker::bind(WrenVM*, const char* module, const char* cls,
+                                             bool is_static, const char* sig) {
+    if (is_static && !std::strcmp(module, "worker") && !std::strcmp(cls, "Worker") &&
+        !std::strcmp(sig, "post(_)"))
+        return &Worker::post;
+    return nullptr;
+}
+
+const char* WorkerPool::Worker::resolve(WrenVM* vm, const char* importer, const char* name) {
+    auto* w = (Worker*)wrenGetUserData(vm);
+    std::string r = resolve_module_name(importer, name, w->modules_dir);
+    char* p = (char*)ScriptingEngine::reallocate(nullptr, r.size() + 1, nullptr);
+    std::memcpy(p, r.c_str(), r.size() + 1);
+    return p;
+}
+
+void WorkerPool::Worker::error(WrenVM* vm, WrenErrorType type, const char* module,
+                               int line, const char* msg) {
+    auto* w = (Worker*)wrenGetUserData(vm);
+    if (type == WREN_ERROR_STACK_TRACE) return; // the message line is enough
+    if (!w->err.empty()) w->err += "; ";
+    if (type == WREN_ERROR_COMPILE)
+        w->err += std::string(module) + ":" + std::to_string(line) + ": " + msg;
+    else
+        w->err += std::string("runtime: ") + msg;
+}
+
+void WorkerPool::Worker::report() {
+    if (err.empty()) return;
+    pool->post([h = pool->handlers_.on_error, id = id, e = std::move(err)] {
+        if (h) h(id, e);
+    });
+    err.clear();
+}
+
+bool WorkerPool::Worker::boot() {
+    TraceScope trace_scope("Worker::boot");
+    WrenConfiguration cfg;
+    wrenInitConfiguration(&cfg);
+    cfg.reallocateFn        = &ScriptingEngine::reallocate;
+    cfg.resolveModuleFn     = &Worker::resolve;
+    cfg.loadModuleFn        = &ScriptingEngine::load_module;
+    cfg.bindForeignMethodFn = &Worker::bind;
+    cfg.writeFn             = &Worker::write;
+    cfg.errorFn             = &Worker::error;
+    cfg.userData            = this;
+    vm = wrenNewVM(&cfg);
+    wrenInterpret(vm, "worker", kWorkerBootstrap);
+    wrenEnsureSlots(vm, 1);
+    wrenGetVariable(vm, "worker", "Worker", 0);
+    cls      = wrenGetSlotHandle(vm, 0);
+    dispatch = wrenMakeCallHandle(vm, "dispatch_(_)");
+
+    std::ifstream f(path);
+    if (!f.is_open()) {
+        err = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    return wrenInterpret(vm, path.c_str(), ss.str().c_str()) == WREN_RESULT_SUCCESS;
+}
+
+bool WorkerPool::Worker::deliver(const WorkerMsg& msg) {
+    TraceScope trace_scope("Worker::deliver");
+    wrenEnsureSlots(vm, 2);
+    wrenSetSlotHandle(vm, 0, cls);
+    write_worker_msg(vm, 1, msg);
+    return wrenCall(vm, dispatch) == WREN_RESULT_SUCCESS;
+}
+
+// ── WorkerPool ───────────────────────────────────────────────────────────────
+
+WorkerPool::WorkerPool(Post post, WorkerHandlers handlers, int threads)
+    : s_(std::make_shared<Shared>()) {
+    s_->post_     = std::move(post);
+    s_->handlers_ = std::move(handlers);
+    if (threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    for (int i = 0; i < threads; ++i) threads_.emplace_back(run_thread, s_);
+}
+
+// A slice can't be interrupted, so a script stuck in a loop would hold exit
+// forever. Threads still busy after a short grace period are detached; they
+// own the shared state and end with the process.
+WorkerPool::~WorkerPool() {
+    std::unique_lock<std::mutex> lk(s_->mu_);
+    s_->quit_ = true;
+    s_->cv_.notify_all();
+    bool idle = s_->cv_.wait_for(lk, std::chrono::milliseconds(100),
+                                 [this] { return s_->busy_ == 0; });
+    lk.unlock();
+    for (auto& t : threads_) {
+        if (idle) t.join();
+        else      t.detach();
+    }
+}
+
+int WorkerPool::spawn(const std::string& path, const std::string& modules_dir) {
+    auto w = std::make_shared<Worker>();
+    w->path        = path;
+    w->modules_dir = modules_dir;
+    w->pool        = s_.get();
+    std::lock_guard<std::mutex> lk(s_->mu_);
+    w->id     = s_->next_id_++;
+    w->queued = true; // first slice boots the VM
+    s_->workers_[w->id] = w;
+    s_->ready_.push_back(w);
+    s_->cv_.notify_one();
+    return w->id;
+}
+
+bool WorkerPool::send(int id, WorkerMsg msg) {
+    std::lock_guard<std::mutex> lk(s_->mu_);
+    auto it = s_->workers_.find(id);
+    if (it == s_->workers_.end()) return false;
+    auto& w = it->second;
+    w->inbox.push_back(std::move(msg));
+    if (!w->queued) {
+        w->queued = true;
+        s_->ready_.push_back(w);
+        s_->cv_.notify_one();
+    }
+    return true;
+}
+
+bool WorkerPool::stop(int id) {
+    std::lock_guard<std::mutex> lk(s_->mu_);
+    auto it = s_->workers_.find(id);
+    if (it == s_->workers_.end()) return false;
+    it->second->stopped = true;
+    it->second->inbox.clear();
+    s_->workers_.erase(it); // the VM goes with the last reference
+    return true;
+}
+
+size_t WorkerPool::size() const {
+    std::lock_guard<std::mutex> lk(s_->mu_);
+    return s_->workers_.size();
+}
+
+void WorkerPool::run_thread(std::shared_ptr<Shared> s) {
+    for (;;) {
+        std::shared_ptr<Worker> w;
+        {
+            std::unique_lock<std::mutex> lk(s->mu_);
+            s->cv_.wait(lk, [&] { return s->quit_ || !s->ready_.empty(); });
+            if (s->quit_) return;
+            w = std::move(s->ready_.front());
+            s->ready_.pop_front();
+            ++s->busy_;
+        }
+        run_slice(*s, w);
+    }
+}
+
+// Up to SLICE messages, then back of the queue so busy workers share threads.
+void WorkerPool::run_slice(Shared& s, const std::shared_ptr<Worker>& w) {
+    constexpr int SLICE = 16;
+    TraceScope trace_scope("WorkerPool::run_slice");
+    bool ok = true;
+    if (!w->started) {
+        w->started = true;
+        ok = w->boot();
+        w->report();
+    }
+    for (int n = 0; ok && n < SLICE; ++n) {
+        WorkerMsg msg;
+        {
+            std::lock_guard<std::mutex> lk(s.mu_);
+            if (w->stopped || s.quit_ || w->inbox.empty()) break;
+            msg = std::move(w->inbox.front());
+            w->inbox.pop_front();
+        }
+        w->deliver(msg);
+        w->report();
+    }
+
+    std::lock_guard<std::mutex> lk(s.mu_);
+    if (!ok) { // script failed to load: nothing can be delivered to it
+        w->stopped = true;
+        w->inbox.clear();
+        s.workers_.erase(w->id);
+    }
+    if (!w->stopped && !w->inbox.empty() && !s.quit_) {
+        s.ready_.push_back(w);
+        s.cv_.notify_one();
+    } else {
+        w->queued = false;
+    }
+    if (--s.busy_ == 0 && s.quit_) s.cv_.notify_all(); // the destructor waits
+}
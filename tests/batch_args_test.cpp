@@ -0,0 +1,61 @@
+// batch_args_test.cpp — slate --batch command-line parsing
+#include "batch.h"
+#include "check.h"
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Parses args as if they followed "slate --batch".
+static bool parse(std::initializer_list<const char*> args, BatchOptions& out,
+                  std::string& err) {
+    std::vector<char*> argv{(char*)"slate", (char*)"--batch"};
+    for (auto* a : args) argv.push_back((char*)a);
+    return parse_batch_args((int)argv.size(), argv.data(), 2, out, err);
+}
+
+static void test_steps() {
+    BatchOptions o;
+    std::string err;
+    CHECK(parse({"-c", ":%s/a/b/g", "-s", "fix.wren", "-c", "w", "a.txt", "b.txt"}, o, err));
+    CHECK(err.empty());
+    CHECK(o.steps.size() == 3);
+    CHECK(!o.steps[0].script && o.steps[0].text == "%s/a/b/g");
+    CHECK(o.steps[1].script && o.steps[1].text == "fix.wren");
+    CHECK(!o.steps[2].script && o.steps[2].text == "w");
+    CHECK(o.files == (std::vector<std::string>{"a.txt", "b.txt"}));
+    CHECK(o.jobs == 0 && o.save);
+}
+
+static void test_options() {
+    BatchOptions o;
+    std::string err;
+    CHECK(parse({"a", "-j", "4", "--no-save", "-c", "d", "-", "--", "-x", "--no-save"}, o, err));
+    CHECK(o.jobs == 4 && !o.save);
+    CHECK(o.files == (std::vector<std::string>{"a", "-", "-x", "--no-save"}));
+}
+
+static void test_errors() {
+    BatchOptions o;
+    std::string err;
+    CHECK(!parse({"-j", "0", "-c", "d", "a"}, o, err) && err.find("-j") != std::string::npos);
+
+    o = {}; err.clear();
+    CHECK(!parse({"-c", "d", "--frobnicate", "a"}, o, err) &&
+          err.find("--frobnicate") != std::string::npos);
+
+    o = {}; err.clear();
+    CHECK(!parse({"a", "-c"}, o, err) && err.find("incomplete") != std::string::npos);
+
+    o = {}; err.clear();
+    CHECK(!parse({"a"}, o, err) && err.find("nothing to do") != std::string::npos);
+
+    o = {}; err.clear();
+    CHECK(!parse({"-c", "d"}, o, err) && err == "no files");
+}
+
+int main() {
+    test_steps();
+    test_options();
+    test_errors();
+    return check_status();
+}
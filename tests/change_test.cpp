@@ -0,0 +1,100 @@
+// change_test.cpp — merge_change/cover and transaction change events
+#include "buffer.h"
+#include "check.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// True if applying 'ranges' to orig could have produced cur: every line
+// outside them must be unchanged and in place.
+static bool explains(const std::vector<int>& orig, const std::vector<int>& cur,
+                     const std::vector<BufferChange>& ranges) {
+    int oi = 0, ci = 0;
+    for (auto& r : ranges) {
+        if (r.start < ci) return false; // unsorted or overlapping
+        for (; ci < r.start; ++ci, ++oi)
+            if (oi >= (int)orig.size() || cur[ci] != orig[oi]) return false;
+        ci += r.inserted;
+        oi += r.removed;
+        if (ci > (int)cur.size() || oi > (int)orig.size()) return false;
+    }
+    if (cur.size() - ci != orig.size() - oi) return false;
+    for (; ci < (int)cur.size(); ++ci, ++oi)
+        if (cur[ci] != orig[oi]) return false;
+    return true;
+}
+
+static void test_merge() {
+    std::vector<BufferChange> rs;
+    merge_change(rs, {5, 1, 1});
+    merge_change(rs, {1, 0, 2}); // before: shifts the first range
+    CHECK(rs.size() == 2 && rs[0].start == 1 && rs[1].start == 7);
+    merge_change(rs, {3, 1, 1}); // touches the first: merged
+    CHECK(rs.size() == 2 && rs[0].start == 1 && rs[0].inserted == 3 &&
+          rs[0].removed == 1);
+    BufferChange c = cover(rs);
+    CHECK(c.start == 1 && c.start + c.inserted == 8 && c.removed == 5);
+    CHECK(cover({}).start == 0 && cover({}).removed == 0 && cover({}).inserted == 0);
+}
+
+// Random edit sequences: the merged list, and its cover, must still explain
+// the text.
+static void test_random() {
+    std::mt19937 rng(35);
+    int fresh = 1000000;
+    for (int iter = 0; iter < 20000; ++iter) {
+        int n = rng() % 20 + 1;
+        std::vector<int> orig(n);
+        for (int i = 0; i < n; ++i) orig[i] = i;
+        auto cur = orig;
+        std::vector<BufferChange> rs;
+        for (int k = rng() % 6 + 1; k > 0; --k) {
+            int s   = rng() % (cur.size() + 1);
+            int rem = rng() % (cur.size() - s + 1);
+            if (rng() % 3 == 0) rem = std::min(rem, 1);
+            int ins = rng() % 4;
+            cur.erase(cur.begin() + s, cur.begin() + s + rem);
+            for (int t = 0; t < ins; ++t) cur.insert(cur.begin() + s, fresh++);
+            merge_change(rs, {s, rem, ins});
+            if (!explains(orig, cur, rs) || !explains(orig, cur, {cover(rs)})) {
+                CHECK(!"merged ranges do not explain the edit");
+                return;
+            }
+        }
+    }
+}
+
+static void test_txn() {
+    Buffer b;
+    b.lines = {"a", "b", "c", "d"};
+    std::vector<BufferChange> fired;
+    b.on_change.push_back([&](Buffer&, const BufferChange& c) { fired.push_back(c); });
+
+    b.begin_txn();
+    b.begin_txn();
+    b.lines[0] = "x";
+    b.fire_change(BufferChange::line(0));
+    b.insert_lines(3, {"p", "q"});
+    b.fire_change({3, 0, 2});
+    b.end_txn();
+    CHECK(fired.empty());
+    b.end_txn();
+    CHECK(fired.size() == 1);
+    CHECK(fired.size() == 1 && fired[0].start == 0 && fired[0].removed == 3 &&
+          fired[0].inserted == 5);
+
+    b.undo();
+    CHECK(b.lines.size() == 4 && b.lines[0] == "a");
+
+    fired.clear();
+    b.begin_txn();
+    b.end_txn(); // nothing changed: no event
+    CHECK(fired.empty());
+}
+
+int main() {
+    test_merge();
+    test_random();
+    test_txn();
+    return check_status();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdio>
+
+// ── Test checks ──────────────────────────────────────────────────────────────
+// CHECK reports a failed condition with its location and keeps going; main()
+// returns check_status() so `meson test` sees the failure.
+inline int& check_failures() {
+    static int n = 0;
+    return n;
+}
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,       \
+                         __LINE__, #cond);                                    \
+            ++check_failures();                                               \
+        }                                                                     \
+    } while (0)
+
+inline int check_status() {
+    if (check_failures()) std::fprintf(stderr, "%d check(s) failed\n", check_failures());
+    return check_failures() ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+// cursors_test.cpp — multi-cursor edits (mc_*) and adjust_cursors
+#include "buffer.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+using Lines = std::vector<std::string>;
+
+static Buffer make(Lines lines, Cursor primary, std::vector<Cursor> others) {
+    Buffer b;
+    b.lines = std::move(lines);
+    b.cursor_row = primary.row;
+    b.cursor_col = primary.col;
+    b.cursors = std::move(others);
+    b.normalize_cursors();
+    return b;
+}
+
+static bool at(const Buffer& b, int row, int col) {
+    return b.cursor_row == row && b.cursor_col == col;
+}
+
+static bool same(const BufferChange& c, int start, int removed, int inserted) {
+    return c.start == start && c.removed == removed && c.inserted == inserted;
+}
+
+static void test_insert() {
+    auto b = make({"abc", "de", "fgh"}, {0, 0}, {{0, 2}, {2, 3}});
+    auto c = b.mc_insert("XY");
+    CHECK(b.lines == (Lines{"XYabXYc", "de", "fghXY"}));
+    CHECK(at(b, 0, 2));
+    CHECK(b.cursors == (std::vector<Cursor>{{0, 6}, {2, 5}}));
+    CHECK(same(c, 0, 3, 3));
+    CHECK(b.modified);
+
+    // The caller fires the change; cursors the edit placed must not move.
+    b.fire_change(c);
+    CHECK(b.cursors == (std::vector<Cursor>{{0, 6}, {2, 5}}));
+}
+
+static void test_backspace() {
+    auto b = make({"abcd"}, {0, 2}, {{0, 0}, {0, 3}});
+    auto c = b.mc_backspace();
+    CHECK(b.lines == (Lines{"ad"}));
+    CHECK(at(b, 0, 1));
+    CHECK(b.cursors == (std::vector<Cursor>{{0, 0}})); // (0,1) merged into primary
+    CHECK(same(c, 0, 1, 1));
+
+    auto z = make({"ab"}, {0, 0}, {});
+    z.mc_backspace(); // column 0 stays put
+    CHECK(z.lines == (Lines{"ab"}) && at(z, 0, 0) && !z.modified);
+}
+
+static void test_delete() {
+    // Overlapping spans merge; nothing past the last one goes.
+    auto b = make({"abcdef"}, {0, 0}, {{0, 1}});
+    b.mc_delete(3);
+    CHECK(b.lines == (Lines{"ef"}));
+    CHECK(at(b, 0, 0) && b.cursors.empty());
+
+    auto d = make({"abcdef", "xyz"}, {0, 0}, {{0, 4}, {1, 2}});
+    auto c = d.mc_delete(1);
+    CHECK(d.lines == (Lines{"bcdf", "xy"}));
+    CHECK(at(d, 0, 0));
+    CHECK(d.cursors == (std::vector<Cursor>{{0, 3}, {1, 2}}));
+    CHECK(same(c, 0, 2, 2));
+
+    auto e = make({"abcdef"}, {0, 1}, {{0, 5}});
+    e.mc_delete(3); // clamped at the line end
+    CHECK(e.lines == (Lines{"ae"}));
+    CHECK(at(e, 0, 1) && e.cursors == (std::vector<Cursor>{{0, 2}}));
+}
+
+static void test_newline() {
+    auto b = make({"abcd", "xy", "z"}, {0, 2}, {{1, 1}});
+    b.folds.add(0, 2);
+    b.folds.add(1, 2);
+    auto c = b.mc_newline();
+    CHECK(b.lines == (Lines{"ab", "cd", "x", "y", "z"}));
+    CHECK(at(b, 1, 0));
+    CHECK(b.cursors == (std::vector<Cursor>{{3, 0}}));
+    CHECK(same(c, 0, 2, 4));
+    auto f = b.folds.ranges();
+    CHECK(f.size() == 2);
+    CHECK(f.size() == 2 && f[0].start == 0 && f[0].end == 4);
+    CHECK(f.size() == 2 && f[1].start == 2 && f[1].end == 4);
+
+    // Two splits on one line.
+    auto t = make({"abc"}, {0, 1}, {{0, 2}});
+    t.mc_newline();
+    CHECK(t.lines == (Lines{"a", "b", "c"}));
+    CHECK(at(t, 1, 0) && t.cursors == (std::vector<Cursor>{{2, 0}}));
+}
+
+static void test_adjust() {
+    auto b = make(Lines(10, "x"), {0, 0}, {{1, 0}, {4, 0}, {5, 0}, {9, 0}});
+    b.lines.erase(b.lines.begin() + 3, b.lines.begin() + 5);
+    b.lines.insert(b.lines.begin() + 3, "y");
+    b.fire_change({3, 2, 1}); // rows 3-4 became one row
+    CHECK(b.cursors == (std::vector<Cursor>{{1, 0}, {3, 0}, {4, 0}, {8, 0}}));
+
+    b.lines.insert(b.lines.begin(), 2, "n");
+    b.adjust_cursors({0, 0, 2});
+    CHECK(b.cursors == (std::vector<Cursor>{{3, 0}, {5, 0}, {6, 0}, {10, 0}}));
+
+    // Cursors in erased rows all land on the row before them, and merge.
+    b.lines.resize(3);
+    b.adjust_cursors({3, 9, 0});
+    CHECK(b.cursors == (std::vector<Cursor>{{2, 0}}));
+}
+
+int main() {
+    test_insert();
+    test_backspace();
+    test_delete();
+    test_newline();
+    test_adjust();
+    return check_status();
+}
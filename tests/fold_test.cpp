@@ -0,0 +1,191 @@
+// fold_test.cpp — FoldTree add/shift against a plain list of ranges
+#include "fold.h"
+#include "check.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Reference model
+// ════════════════════════════════════════════════════════════════════════════
+
+// The same rules as FoldTree, one linear scan at a time.
+struct ModelFolds {
+    std::vector<FoldRange> folds; // sorted by start
+
+    bool add(int start, int end, bool closed) {
+        if (start < 0 || end <= start) return false;
+        for (auto& f : folds) {
+            if (f.start == start) continue; // replaced
+            bool around = f.start < start && start <= f.end && f.end < end;
+            bool inside = start < f.start && f.start <= end && f.end > end;
+            if (around || inside) return false;
+        }
+        folds.erase(std::remove_if(folds.begin(), folds.end(),
+                                   [&](const FoldRange& f) { return f.start == start; }),
+                    folds.end());
+        folds.push_back({start, end, FoldKind::Manual, closed});
+        sort();
+        return true;
+    }
+
+    void shift(int at, int delta) {
+        std::vector<FoldRange> out;
+        for (auto f : folds) {
+            if (f.start >= at) {
+                if (delta < 0 && f.start < at - delta) continue; // erased
+                f.start += delta;
+                f.end += delta;
+            } else if (f.end >= at) {
+                if (delta > 0 || f.end >= at - delta) f.end += delta;
+                else                                   f.end = at - 1;
+                if (f.end <= f.start) continue;
+            }
+            out.push_back(f);
+        }
+        folds = out;
+        sort();
+    }
+
+    int visible_row(int row) const {
+        for (auto& f : folds) // outermost first: sorted by start
+            if (f.closed && f.start < row && row <= f.end) return f.start;
+        return row;
+    }
+
+    void sort() {
+        std::sort(folds.begin(), folds.end(),
+                  [](const FoldRange& a, const FoldRange& b) { return a.start < b.start; });
+    }
+};
+
+static bool same(const std::vector<FoldRange>& a, const std::vector<FoldRange>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].start != b[i].start || a[i].end != b[i].end ||
+            a[i].closed != b[i].closed)
+            return false;
+    return true;
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+//  Cases
+// ════════════════════════════════════════════════════════════════════════════
+
+static void test_add() {
+    FoldTree t;
+    CHECK(t.add(2, 8));
+    CHECK(t.add(3, 5));          // nested
+    CHECK(t.add(10, 12));        // disjoint
+    CHECK(!t.add(4, 9));         // crosses 2..8
+    CHECK(!t.add(1, 3));         // crosses 3..5 and 2..8
+    CHECK(!t.add(5, 5));         // empty
+    CHECK(t.add(3, 6));          // replaces 3..5
+    CHECK(t.size() == 3);
+    FoldRange f;
+    CHECK(t.innermost(4, f) && f.start == 3 && f.end == 6);
+    CHECK(!t.add(3, 9));         // a failed replace keeps the old fold
+    CHECK(t.innermost(4, f) && f.start == 3 && f.end == 6);
+}
+
+static void test_shift() {
+    FoldTree t;
+    t.add(2, 8, FoldKind::Manual, true);
+    t.add(10, 12);
+
+    t.shift(5, 3);               // inside 2..8, above 10..12
+    auto r = t.ranges();
+    CHECK(r.size() == 2 && r[0].end == 11 && r[1].start == 13 && r[1].end == 15);
+
+    t.shift(0, -2);              // erase lines 0..1
+    r = t.ranges();
+    CHECK(r.size() == 2 && r[0].start == 0 && r[0].end == 9 && r[1].start == 11);
+
+    t.shift(0, -1);              // erase a fold's start line: it goes
+    r = t.ranges();
+    CHECK(r.size() == 1 && r[0].start == 10 && r[0].end == 12);
+
+    t.shift(11, -5);             // erase past the end: clipped, then empty
+    CHECK(t.empty());
+}
+
+static void test_visible() {
+    FoldTree t;
+    t.add(2, 8, FoldKind::Manual, true);
+    t.add(4, 6, FoldKind::Manual, true);
+    CHECK(t.visible_row(1) == 1);
+    CHECK(t.visible_row(5) == 2);
+    CHECK(t.next_visible(2) == 9);
+    t.set_closed(2, false);
+    CHECK(t.visible_row(5) == 4);
+    CHECK(t.next_visible(4) == 7);
+}
+
+// Random adds and shifts must leave the tree and the model in step.
+static void test_random() {
+    std::mt19937 rng(26);
+    for (int round = 0; round < 300; ++round) {
+        FoldTree t;
+        ModelFolds m;
+        int lines = 60;
+        for (int op = 0; op < 80; ++op) {
+            if (rng() % 3) {
+                int s = rng() % lines, e = s + 1 + rng() % 12;
+                bool closed = rng() % 2;
+                CHECK(t.add(s, e, FoldKind::Manual, closed) == m.add(s, e, closed));
+            } else {
+                int at = rng() % lines;
+                int delta = (int)(rng() % 9) - 4;
+                if (delta < 0) delta = -std::min(-delta, lines - at);
+                t.shift(at, delta);
+                m.shift(at, delta);
+                lines += delta;
+                if (lines < 1) lines = 1;
+            }
+            if (!same(t.ranges(), m.folds)) {
+                CHECK(!"ranges differ from the model");
+                return;
+            }
+            for (int row = 0; row < lines + 12; ++row)
+                CHECK(t.visible_row(row) == m.visible_row(row));
+        }
+    }
+}
+
+// A scan requested while another runs starts once that one is polled in;
+// the stale result is dropped and the fresh one installed.
+static void test_indent_rescan() {
+    std::vector<std::string> v1 = {"a", "  b", "  c"};
+    std::vector<std::string> v2 = {"a", "  b", "c", "  d", "  e"};
+    FoldTree t;
+    t.request_indent(v1, 1);
+    t.request_indent(v2, 2);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    auto want = compute_indent_folds(v2);
+    while (!same(t.ranges(), want) && std::chrono::steady_clock::now() < deadline) {
+        t.poll_indent(v2, 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(same(t.ranges(), want));
+    CHECK(t.size() == 2);
+
+    // Dropping a tree mid-scan must not wait for it.
+    std::vector<std::string> big(200000, "  x");
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        FoldTree u;
+        u.request_indent(big, 1);
+    }
+    CHECK(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(1));
+}
+
+int main() {
+    test_add();
+    test_shift();
+    test_visible();
+    test_random();
+    test_indent_rescan();
+    return check_status();
+}
@@ -0,0 +1,76 @@
+// jobs_test.cpp — JobManager output, exit codes, queueing and cancel
+#include "jobs.h"
+#include "check.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Stands in for the UI loop: the reactor posts here, main() drains.
+struct PostQueue {
+    std::mutex                        mu;
+    std::condition_variable           cv;
+    std::deque<std::function<void()>> q;
+
+    JobManager::Post post() {
+        return [this](std::function<void()> f) {
+            std::lock_guard<std::mutex> lk(mu);
+            q.push_back(std::move(f));
+            cv.notify_all();
+        };
+    }
+    // Runs posted work until done() holds; false on a 20 s timeout.
+    template <class Done> bool run_until(Done done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        while (!done()) {
+            std::unique_lock<std::mutex> lk(mu);
+            if (!cv.wait_until(lk, deadline, [&] { return !q.empty(); })) return false;
+            auto f = std::move(q.front());
+            q.pop_front();
+            lk.unlock();
+            f();
+        }
+        return true;
+    }
+};
+
+int main() {
+    PostQueue ui;
+    JobManager jm(ui.post(), 2);
+    const int NONE = -1000;
+    std::string out1, err1, out4;
+    int st1 = NONE, st2 = NONE, st3 = NONE, st4 = NONE;
+
+    jm.spawn("seq 1 100000; echo oops >&2; sleep 0.2; exit 3",
+             {[&](JobStream s, const std::string& c) {
+                  (s == JobStream::Stdout ? out1 : err1) += c;
+              },
+              [&](int s) { st1 = s; }});
+    int id2 = jm.spawn("sleep 30", {nullptr, [&](int s) { st2 = s; }});
+    int id3 = jm.spawn("sleep 30", {nullptr, [&](int s) { st3 = s; }});
+    jm.spawn("printf abc", {[&](JobStream, const std::string& c) { out4 += c; },
+                            [&](int s) { st4 = s; }});
+
+    // The reactor starts jobs on its own thread; never more than two at once.
+    auto jobs = jm.list();
+    int running = 0;
+    for (auto& j : jobs) running += j.running;
+    CHECK(jobs.size() == 4 && running <= 2);
+
+    // Job 1 holds its slot for 0.2 s, so job 3 is still queued here.
+    CHECK(jm.cancel(id3)); // dropped without running
+    CHECK(ui.run_until([&] { return st1 != NONE && st3 != NONE; }));
+    CHECK(st3 == -1);
+    CHECK(st1 == 3);
+    CHECK(err1 == "oops\n");
+    CHECK(out1.size() == 588895); // "1\n" .. "100000\n"
+
+    CHECK(jm.cancel(id2)); // running: SIGTERM
+    CHECK(ui.run_until([&] { return st2 != NONE && st4 != NONE; }));
+    CHECK(st2 == 128 + 15);
+    CHECK(st4 == 0 && out4 == "abc");
+
+    CHECK(!jm.cancel(id2)); // already gone
+    CHECK(jm.list().empty());
+    return check_status();
+}
@@ -0,0 +1,111 @@
+// keymap_test.cpp — Keymap trie and KeyReader count/sequence parsing
+#include "keymap.h"
+#include "check.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+// A bound action that only names itself, so results can be told apart
+// without a Buffer or Editor to run them on.
+struct Tag {
+    std::string name;
+    void operator()(Buffer&, Editor&, int) const {}
+};
+
+static std::string name_of(const KeyReader::Result& r) {
+    auto* t = r.action.target<Tag>();
+    return t ? t->name : "";
+}
+
+static Keymap make_keymap() {
+    Keymap km;
+    for (const char* seq : {"j", "0", "dd", "dw", "g", "gg", "zo", "é"})
+        km.bind(seq, Tag{seq});
+    return km;
+}
+
+// Feeds each key of seq; returns the last result.
+static KeyReader::Result feed(KeyReader& kr, const Keymap& km, const std::string& seq) {
+    KeyReader::Result r;
+    for (auto& k : split_keys(seq)) r = kr.feed(km, k);
+    return r;
+}
+
+static void test_keymap() {
+    Keymap km = make_keymap();
+    CHECK(split_keys("zé") == (std::vector<std::string>{"z", "é"}));
+    CHECK(km.find("dd") && !km.find("d") && !km.find("dx"));
+    int d = km.next(Keymap::ROOT, "d");
+    CHECK(d >= 0 && km.has_next(d) && !km.action(d));
+    int j = km.next(Keymap::ROOT, "j");
+    CHECK(j >= 0 && !km.has_next(j) && km.action(j));
+    km.clear();
+    CHECK(!km.find("j"));
+}
+
+static void test_counts() {
+    Keymap km = make_keymap();
+    KeyReader kr(1000000);
+
+    auto r = feed(kr, km, "500j");
+    CHECK(name_of(r) == "j" && r.count == 500 && !kr.pending());
+
+    r = feed(kr, km, "0"); // no count yet: "0" is a key
+    CHECK(name_of(r) == "0" && r.count == 0);
+
+    r = feed(kr, km, "3dd");
+    CHECK(name_of(r) == "dd" && r.count == 3);
+
+    r = feed(kr, km, "99999999j");
+    CHECK(name_of(r) == "j" && r.count == KeyReader::MAX_COUNT);
+
+    feed(kr, km, "42");
+    CHECK(kr.pending());
+    CHECK(kr.take_count() == 42 && !kr.pending());
+
+    r = feed(kr, km, "é");
+    CHECK(name_of(r) == "é");
+}
+
+static void test_sequences() {
+    Keymap km = make_keymap();
+    KeyReader kr(1000000);
+
+    auto r = feed(kr, km, "d");
+    CHECK(!r.action && r.consumed && kr.pending());
+    r = feed(kr, km, "w");
+    CHECK(name_of(r) == "dw" && !kr.pending());
+
+    r = feed(kr, km, "2gg");
+    CHECK(name_of(r) == "gg" && r.count == 2);
+
+    // "g" is bound and also a prefix: another key runs it and is fed again.
+    r = feed(kr, km, "5gj");
+    CHECK(name_of(r) == "g" && r.count == 5 && r.again && !kr.pending());
+
+    // An unbound prefix is dropped.
+    r = feed(kr, km, "dj");
+    CHECK(!r.action && r.again && !kr.pending());
+
+    r = feed(kr, km, "x");
+    CHECK(!r.action && !r.consumed);
+    r = feed(kr, km, "3x"); // the count goes with the unbound key
+    CHECK(!r.consumed && !kr.pending());
+}
+
+static void test_timeout() {
+    Keymap km = make_keymap();
+    KeyReader kr(1);
+    feed(kr, km, "7g");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto r = feed(kr, km, "j");
+    CHECK(name_of(r) == "g" && r.count == 7 && r.again && !kr.pending());
+}
+
+int main() {
+    test_keymap();
+    test_counts();
+    test_sequences();
+    test_timeout();
+    return check_status();
+}
@@ -0,0 +1,78 @@
+// range_test.cpp — characterwise spans and blockwise edits on Buffer
+#include "buffer.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+using Lines = std::vector<std::string>;
+
+static Buffer make(Lines lines) {
+    Buffer b;
+    b.lines = std::move(lines);
+    return b;
+}
+
+static bool same(const BufferChange& c, int start, int removed, int inserted) {
+    return c.start == start && c.removed == removed && c.inserted == inserted;
+}
+
+static void test_char_span() {
+    auto b = make({"hello", "world", "xyz"});
+    CHECK(b.text_range({0, 3}, {2, 1}) == "lo\nworld\nx");
+    CHECK(b.text_range({1, 1}, {1, 3}) == "or");
+    CHECK(b.text_range({0, 9}, {1, 0}) == "\n"); // columns clip to the line
+
+    auto c = b.erase_range({0, 3}, {2, 1});
+    CHECK(b.lines == (Lines{"helyz"}));
+    CHECK(b.cursor_row == 0 && b.cursor_col == 3);
+    CHECK(same(c, 0, 3, 1));
+
+    c = b.insert_text(0, 3, {"lo", "world", "x"}); // puts it back
+    CHECK(b.lines == (Lines{"hello", "world", "xyz"}));
+    CHECK(b.cursor_row == 2 && b.cursor_col == 1);
+    CHECK(same(c, 0, 1, 3));
+
+    c = b.insert_text(1, 2, {"--"});
+    CHECK(b.lines[1] == "wo--rld" && b.cursor_col == 4 && same(c, 1, 1, 1));
+}
+
+static void test_block_clipped() {
+    auto b = make({"abcdef", "ab", "a", "abcd"});
+    CHECK(b.block_text(0, 3, 1, 4) == (Lines{"bcd", "b", "", "bcd"}));
+    auto c = b.erase_block(0, 3, 1, 4);
+    CHECK(b.lines == (Lines{"aef", "a", "a", "a"}));
+    CHECK(same(c, 0, 4, 4));
+}
+
+static void test_put_block() {
+    // Past the last line: new rows, short rows padded out to the column.
+    auto b = make({"ab", "x"});
+    auto c = b.put_block(1, 3, {"12", "34", "5"});
+    CHECK(b.lines == (Lines{"ab", "x  12", "   34", "   5"}));
+    CHECK(same(c, 1, 1, 3));
+
+    // Text after the column: each copy is padded to the block's width.
+    auto t = make({"abcd", "abcd"});
+    t.put_block(0, 1, {"X", "YZ"});
+    CHECK(t.lines == (Lines{"aX bcd", "aYZbcd"}));
+}
+
+static void test_counted_put() {
+    auto b = make({"ab", "ab"});
+    b.put_block(0, 1, {"X", "YZ"}, 3);
+    CHECK(b.lines == (Lines{"aX X X b", "aYZYZYZb"}));
+
+    // At the line end the last copy is not padded.
+    auto e = make({"a", "a"});
+    auto c = e.put_block(0, 1, {"X", "YZ"}, 2);
+    CHECK(e.lines == (Lines{"aX X", "aYZYZ"}));
+    CHECK(same(c, 0, 2, 2));
+}
+
+int main() {
+    test_char_span();
+    test_block_clipped();
+    test_put_block();
+    test_counted_put();
+    return check_status();
+}